@@ -0,0 +1,282 @@
+#include <iostream>
+#include <Eigen/Geometry>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Wrt.h"
+using namespace std;
+
+/*
+* Benchmark of the Get and Set operations of the library, without the Python bindings.
+*
+* Each case times every operation separately and reports the minimum, median and 99th percentile latencies
+* along with the throughput, as a JSON document written to the standard output. The worlds are deleted once measured.
+*
+* Usage: wrt-bench [--iterations n] [--dir directory] [--quick]
+*/
+
+/// Options of the benchmark, set from the command line.
+struct BenchOptions{
+    /// Number of timed operations per case with a warm cache, a tenth of it with a cold cache.
+    size_t iterations = 2000;
+    /// Directory in which the temporary worlds are created.
+    string dir = "/tmp";
+    /// Use small worlds and few iterations, to check that the benchmark runs.
+    bool quick = false;
+};
+
+/// Shape of the tree and query measured by a case.
+struct BenchCase{
+    string name;
+    string operation;
+    string world;
+    size_t depth;
+    size_t fanout;
+    size_t frames;
+    string subject;
+    string basis;
+    string csys;
+    string cache;
+};
+
+/*
+* Create a world holding a tree in which every frame has fanout children, down to the specified depth,
+* or a chain if fanout is 1. Frame names encode their path from the world frame, such as n-0-3-1.
+*
+* @return: Number of frames created.
+*/
+size_t BuildTree(DbConnector& wrt, const string& world_name, size_t depth, size_t fanout){
+    BulkWriter writer(wrt.In(world_name), 100000);
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+    pose.linear() = Eigen::AngleAxisd(0.1, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+    pose.translation() << 0.1, 0.2, 0.3;
+    vector<string> level = {"world"};
+    size_t count = 0;
+    for(size_t d = 0; d < depth; d++){
+        vector<string> next_level;
+        for(auto const& parent : level){
+            for(size_t i = 0; i < fanout; i++){
+                string name = (parent == "world" ? string("n") : parent) + "-" + to_string(i);
+                next_level.push_back(name);
+                writer.Set(name, parent, parent, pose.matrix());
+                count++;
+            }
+        }
+        level = move(next_level);
+    }
+    writer.Commit();
+    return count;
+}
+
+/*
+* Name of the deepest frame reached by always taking the specified child.
+*/
+string Leaf(size_t depth, size_t child){
+    string name = "n";
+    for(size_t d = 0; d < depth; d++)
+        name += "-" + to_string(child);
+    return name;
+}
+
+/*
+* Drop the pages of the database of a world from the page cache of the kernel, which does not require privileges.
+*/
+void DropPageCache(const string& world_path){
+    for(auto const& suffix : {".db", ".db-wal"}){
+        int fd = open((world_path + suffix).c_str(), O_RDONLY);
+        if(fd < 0)
+            continue;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/*
+* Delete the database of a world, along with its WAL and shared memory files.
+*/
+void RemoveWorld(const string& world_path){
+    for(auto const& suffix : {".db", ".db-wal", ".db-shm"})
+        std::filesystem::remove(world_path + suffix);
+}
+
+/*
+* Time each call to operation and write the statistics of a case as a JSON object.
+*/
+void Measure(const BenchCase& c, size_t iterations, function<void()> operation, bool& first){
+    //A few untimed calls fill the caches, except when measuring a cold cache.
+    if(c.cache == "warm")
+        for(size_t i = 0; i < min(iterations / 10 + 1, size_t(100)); i++)
+            operation();
+    vector<double> latencies;
+    latencies.reserve(iterations);
+    auto start = chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++){
+        auto before = chrono::steady_clock::now();
+        operation();
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p){
+        return latencies[min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+
+    cout << (first ? "\n" : ",\n");
+    first = false;
+    cout << "    {\"name\": \"" << c.name << "\", \"operation\": \"" << c.operation << "\", \"world\": \"" << c.world << "\", \"subject\": \"" << c.subject << "\", \"depth\": " << c.depth
+         << ", \"fanout\": " << c.fanout << ", \"frames\": " << c.frames << ", \"basis\": \"" << c.basis << "\", \"csys\": \"" << c.csys
+         << "\", \"cache\": \"" << c.cache << "\", \"iterations\": " << iterations
+         << ", \"min_us\": " << latencies.front() << ", \"median_us\": " << percentile(0.5) << ", \"p99_us\": " << percentile(0.99)
+         << ", \"ops_per_s\": " << iterations / seconds << "}" << flush;
+    cerr << c.name << ": median " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us" << endl;
+}
+
+int main(int argc, char *argv[]){
+    BenchOptions options;
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            options.iterations = max(stoul(argv[++i]), 1ul);
+        else if(strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+            options.dir = argv[++i];
+        else if(strcmp(argv[i], "--quick") == 0)
+            options.quick = true;
+        else{
+            cerr << "Usage: wrt-bench [--iterations n] [--dir directory] [--quick]" << endl;
+            return 1;
+        }
+    }
+    if(options.quick)
+        options.iterations = min(options.iterations, size_t(50));
+    size_t cold_iterations = max(options.iterations / 10, size_t(1));
+
+    string dir = string(std::filesystem::absolute(options.dir));
+    auto wrt = DbConnector(dir, 0);
+    Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+    pose(0,3) = 1;
+    bool first = true;
+    cout << "{\"iterations\": " << options.iterations << ", \"results\": [";
+
+    //Latency as a function of the depth of the frame, through chains.
+    vector<size_t> depths = options.quick ? vector<size_t>{1, 10} : vector<size_t>{1, 10, 100, 1000};
+    for(auto depth : depths){
+        string world_name = "bench-depth-" + to_string(depth);
+        RemoveWorld(dir + "/" + world_name);
+        size_t frames = BuildTree(wrt, world_name, depth, 1);
+        auto world = wrt.In(world_name);
+        string leaf = Leaf(depth, 0);
+        BenchCase c{"get-depth-"+to_string(depth), "get", world_name, depth, 1, frames, leaf, "world", "world", "warm"};
+        Measure(c, options.iterations, [&](){ world.Get(leaf).Wrt("world").Ei("world"); }, first);
+
+        c.name = "get-compiled-depth-"+to_string(depth);
+        c.operation = "get-compiled";
+        auto compiled = world.Get(leaf).Wrt("world").Compile("world");
+        Measure(c, options.iterations, [&](){ compiled(); }, first);
+
+        c.name = "get-cold-depth-"+to_string(depth);
+        c.operation = "get";
+        c.cache = "cold";
+        Measure(c, cold_iterations, [&](){
+            DropPageCache(dir + "/" + world_name);
+            GetSet(dir + "/" + world_name).Get(leaf).Wrt("world").Ei("world");
+        }, first);
+
+        c.name = "set-depth-"+to_string(depth);
+        c.operation = "set";
+        c.cache = "warm";
+        c.basis = c.csys = depth > 1 ? Leaf(depth - 1, 0) : "world";
+        Measure(c, options.iterations, [&](){ world.Set(leaf).Wrt(c.basis).Ei(c.basis).As(pose); }, first);
+        RemoveWorld(dir + "/" + world_name);
+    }
+
+    //Latency as a function of the number of frames in the world, all children of the world frame.
+    vector<size_t> sizes = options.quick ? vector<size_t>{100} : vector<size_t>{100, 10000, 100000};
+    for(auto size : sizes){
+        string world_name = "bench-size-" + to_string(size);
+        RemoveWorld(dir + "/" + world_name);
+        size_t frames = BuildTree(wrt, world_name, 1, size);
+        auto world = wrt.In(world_name);
+        string subject = "n-" + to_string(size / 2);
+        BenchCase c{"get-size-"+to_string(size), "get", world_name, 1, size, frames, subject, "world", "world", "warm"};
+        Measure(c, options.iterations, [&](){ world.Get(subject).Wrt("world").Ei("world"); }, first);
+
+        c.name = "set-size-"+to_string(size);
+        c.operation = "set";
+        Measure(c, options.iterations, [&](){ world.Set(subject).Wrt("world").Ei("world").As(pose); }, first);
+
+        c.name = "set-new-size-"+to_string(size);
+        c.operation = "set-new";
+        size_t count = 0;
+        Measure(c, options.iterations, [&](){ world.Set("new-"+to_string(count++)).Wrt("world").Ei("world").As(pose); }, first);
+        RemoveWorld(dir + "/" + world_name);
+    }
+
+    //Latency as a function of the fan-out and of the frames the pose is described with respect to and expressed in.
+    vector<pair<size_t, size_t>> trees = options.quick ? vector<pair<size_t, size_t>>{{2, 4}} : vector<pair<size_t, size_t>>{{2, 12}, {10, 4}, {100, 2}};
+    for(auto [fanout, depth] : trees){
+        string world_name = "bench-fanout-" + to_string(fanout);
+        RemoveWorld(dir + "/" + world_name);
+        size_t frames = BuildTree(wrt, world_name, depth, fanout);
+        auto world = wrt.In(world_name);
+        string subject = Leaf(depth, 0);
+        //Leaves on the other side of the tree, which only share the world frame with the subject.
+        string other = Leaf(depth, fanout - 1);
+        string sibling = Leaf(depth - 1, 0) + "-" + to_string(fanout - 1);
+        vector<pair<string, string>> combinations = {{"world", "world"}, {sibling, sibling}, {other, other}, {other, "world"}, {other, sibling}};
+        for(auto const& [basis, csys] : combinations){
+            string label = (basis == "world" ? "world" : basis == other ? "other" : "sibling") + string("-") + (csys == "world" ? "world" : csys == other ? "other" : "sibling");
+            BenchCase c{"get-fanout-"+to_string(fanout)+"-"+label, "get", world_name, depth, fanout, frames, subject, basis, csys, "warm"};
+            Measure(c, options.iterations, [&](){ world.Get(subject).Wrt(basis).Ei(csys); }, first);
+        }
+        BenchCase c{"set-fanout-"+to_string(fanout)+"-other-world", "set", world_name, depth, fanout, frames, subject, other, "world", "warm"};
+        //Setting the subject with respect to a frame that is not its parent moves it under that frame.
+        Measure(c, options.iterations, [&](){ world.Set(subject).Wrt(other).Ei("world").As(pose); }, first);
+        RemoveWorld(dir + "/" + world_name);
+    }
+
+    //Latency of the transformations computed by the queries, with the rigid transformations of SE3.h and with the affine
+    // transformations of Eigen they replaced. Each case chains 1000 dependent operations, such that the latencies in
+    // microseconds are nanoseconds per operation.
+    const size_t chain = 1000;
+    Eigen::Affine3d affine = Eigen::Affine3d::Identity();
+    affine.linear() = Eigen::AngleAxisd(0.1, Eigen::Vector3d(1,2,3).normalized()).toRotationMatrix();
+    affine.translation() << 0.1, 0.2, 0.3;
+    Eigen::Affine3d affine_result = affine;
+    SE3 se3(affine.matrix()), se3_result = se3;
+    SE3Quaternion se3_quaternion(se3), se3_quaternion_result = se3_quaternion;
+    vector<pair<string, function<void()>>> transformations = {
+        {"affine-inverse", [&](){ for(size_t i = 0; i < chain; i++) affine_result = affine_result.inverse(); }},
+        {"se3-inverse", [&](){ for(size_t i = 0; i < chain; i++) se3_result = se3_result.Inverse(); }},
+        {"se3-quaternion-inverse", [&](){ for(size_t i = 0; i < chain; i++) se3_quaternion_result = se3_quaternion_result.Inverse(); }},
+        {"affine-compose", [&](){ for(size_t i = 0; i < chain; i++) affine_result = affine * affine_result; }},
+        {"se3-compose", [&](){ for(size_t i = 0; i < chain; i++) se3_result = se3 * se3_result; }},
+        {"se3-quaternion-compose", [&](){ for(size_t i = 0; i < chain; i++) se3_quaternion_result = se3_quaternion * se3_quaternion_result; }},
+        //Pose of a frame relative to a basis and expressed in a third frame, from their poses relative to the root.
+        {"affine-reexpress", [&](){
+            for(size_t i = 0; i < chain; i++){
+                Eigen::Affine3d X_S_B = affine.inverse() * affine_result;
+                Eigen::Affine3d X_S_B_C = Eigen::Affine3d::Identity();
+                X_S_B_C.linear() = X_S_B.rotation();
+                X_S_B_C.translation() = affine.inverse().rotation() * affine.rotation() * X_S_B.translation();
+                affine_result = X_S_B_C;
+            }
+        }},
+        {"se3-reexpress", [&](){
+            for(size_t i = 0; i < chain; i++)
+                se3_result = (se3.Inverse() * se3_result).Reexpressed(se3.rotation).Reexpressed(se3.rotation.transpose());
+        }},
+    };
+    for(auto const& [name, operation] : transformations){
+        BenchCase c{name+"-x"+to_string(chain), "transformation", "", 0, 0, 0, "", "", "", "warm"};
+        Measure(c, options.iterations, operation, first);
+    }
+
+    cout << "\n]}" << endl;
+    return 0;
+}
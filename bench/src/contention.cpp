@@ -0,0 +1,253 @@
+#include <iostream>
+#include <Eigen/Geometry>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Wrt.h"
+using namespace std;
+
+/*
+* Contention benchmark: N reader processes and M writer processes work on the same world at the same time.
+*
+* Every operation is timed, including the time spent waiting for the locks held by the other processes, and the
+* number of times SQLite reported the database as busy is counted. For each combination of N and M, the 50th, 99th
+* and 99.9th percentiles, the maximum latency and the throughput of the readers and of the writers are written as
+* a JSON document to the standard output. Nothing is dropped as an outlier.
+*
+* Usage: wrt-contention [--readers 1,2,4,8] [--writers 0,1,2,4] [--duration seconds] [--depth n] [--dir directory] [--quick]
+*/
+
+/// Options of the benchmark, set from the command line.
+struct ContentionOptions{
+    /// Numbers of reader processes to try.
+    vector<size_t> readers = {1, 2, 4, 8};
+    /// Numbers of writer processes to try.
+    vector<size_t> writers = {0, 1, 2, 4};
+    /// Time in seconds during which the processes run for each combination.
+    double duration = 2;
+    /// Depth of the frame read by the readers.
+    size_t depth = 10;
+    /// Directory in which the temporary world is created.
+    string dir = "/tmp";
+};
+
+/// Outcome of the operations performed by one process.
+struct ProcessResult{
+    /// Latency of each successful operation, in microseconds.
+    vector<double> latencies;
+    /// Number of times SQLite found the database locked by another connection and waited.
+    uint64_t busy_retries = 0;
+    /// Number of operations that failed, such as when a lock was not released before the timeout.
+    uint64_t failures = 0;
+};
+
+/*
+* Parse a list of numbers separated by commas, such as 1,2,4.
+*/
+vector<size_t> ParseCounts(const string& text){
+    vector<size_t> counts;
+    stringstream stream(text);
+    string item;
+    while(getline(stream, item, ','))
+        counts.push_back(stoul(item));
+    return counts;
+}
+
+/*
+* Perform operations until the deadline, in a process that has just been forked.
+*
+* @param writer: Whether the process sets a frame of its own or gets the pose of the deepest frame.
+*/
+ProcessResult RunProcess(const string& world_path, bool writer, size_t index, size_t depth, chrono::steady_clock::time_point start, chrono::steady_clock::time_point deadline){
+    ProcessResult result;
+    //The retries of the busy handler of the library are counted in the statistics of the world.
+    auto stats = StatsCollector::Register(world_path);
+    auto db = DbConnector::Connect(world_path, 10000);
+    string leaf = "chain-" + to_string(depth - 1);
+    string subject = "writer-" + to_string(index);
+    Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+    this_thread::sleep_until(start);
+    size_t i = 0;
+    while(chrono::steady_clock::now() < deadline){
+        auto before = chrono::steady_clock::now();
+        try{
+            //Each operation is prepared again, as done by In("world").Get(...).Wrt(...).Ei(...).
+            if(writer){
+                pose(0,3) = i++;
+                CompiledSet(db, world_path, subject, "world", "world").As(pose);
+            }else{
+                CompiledGet(db, world_path, leaf, "world", "world")();
+            }
+            result.latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+        }catch(const std::exception& err){
+            result.failures++;
+        }
+    }
+    result.busy_retries = stats->busy_retries;
+    return result;
+}
+
+/*
+* Write all the bytes of a buffer to a file descriptor.
+*/
+void WriteAll(int fd, const void* data, size_t size){
+    const char* bytes = (const char*)data;
+    while(size > 0){
+        ssize_t written = write(fd, bytes, size);
+        if(written <= 0)
+            _exit(1);
+        bytes += written;
+        size -= written;
+    }
+}
+
+/*
+* Read exactly the specified number of bytes from a file descriptor.
+*
+* @return: False if the end of the file is reached first.
+*/
+bool ReadAll(int fd, void* data, size_t size){
+    char* bytes = (char*)data;
+    while(size > 0){
+        ssize_t count = read(fd, bytes, size);
+        if(count <= 0)
+            return false;
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+/*
+* Write the statistics of the operations of one role as a JSON object.
+*/
+void Report(const string& role, size_t readers, size_t writers, ProcessResult& total, double seconds, bool& first){
+    auto& latencies = total.latencies;
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p){
+        return latencies.empty() ? 0 : latencies[min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+    cout << (first ? "\n" : ",\n");
+    first = false;
+    cout << "    {\"readers\": " << readers << ", \"writers\": " << writers << ", \"role\": \"" << role << "\""
+         << ", \"operations\": " << latencies.size() << ", \"ops_per_s\": " << latencies.size() / seconds
+         << ", \"p50_us\": " << percentile(0.5) << ", \"p99_us\": " << percentile(0.99) << ", \"p999_us\": " << percentile(0.999)
+         << ", \"max_us\": " << (latencies.empty() ? 0 : latencies.back())
+         << ", \"busy_retries\": " << total.busy_retries << ", \"failures\": " << total.failures << "}" << flush;
+    cerr << readers << " readers, " << writers << " writers, " << role << ": p50 " << percentile(0.5) << " us, p99.9 " << percentile(0.999)
+         << " us, max " << (latencies.empty() ? 0 : latencies.back()) << " us, " << total.busy_retries << " busy retries, " << total.failures << " failures" << endl;
+}
+
+int main(int argc, char *argv[]){
+    ContentionOptions options;
+    try{
+        for(int i = 1; i < argc; i++){
+            if(strcmp(argv[i], "--readers") == 0 && i + 1 < argc)
+                options.readers = ParseCounts(argv[++i]);
+            else if(strcmp(argv[i], "--writers") == 0 && i + 1 < argc)
+                options.writers = ParseCounts(argv[++i]);
+            else if(strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+                options.duration = stod(argv[++i]);
+            else if(strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+                options.depth = max(stoul(argv[++i]), 1ul);
+            else if(strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+                options.dir = argv[++i];
+            else if(strcmp(argv[i], "--quick") == 0){
+                options.readers = {1, 2};
+                options.writers = {0, 1};
+                options.duration = 0.2;
+            }else
+                throw invalid_argument(argv[i]);
+        }
+    }catch(const std::logic_error& err){
+        cerr << "Usage: wrt-contention [--readers 1,2,4,8] [--writers 0,1,2,4] [--duration seconds] [--depth n] [--dir directory] [--quick]" << endl;
+        return 1;
+    }
+
+    string dir = string(std::filesystem::absolute(options.dir));
+    string world_name = "bench-contention";
+    string world_path = dir + "/" + world_name;
+    bool first = true;
+    cout << "{\"duration\": " << options.duration << ", \"depth\": " << options.depth << ", \"results\": [";
+    for(auto readers : options.readers){
+        for(auto writers : options.writers){
+            if(readers + writers == 0)
+                continue;
+            //A fresh world for each combination, closed before forking as connections cannot be shared by processes.
+            for(auto const& suffix : {".db", ".db-wal", ".db-shm"})
+                std::filesystem::remove(world_path + suffix);
+            {
+                auto wrt = DbConnector(dir, 0);
+                BulkWriter writer(wrt.In(world_name));
+                Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+                pose(2,3) = 0.1;
+                for(size_t i = 0; i < options.depth; i++){
+                    string parent = i == 0 ? "world" : "chain-" + to_string(i - 1);
+                    writer.Set("chain-" + to_string(i), parent, parent, pose);
+                }
+                for(size_t i = 0; i < writers; i++)
+                    writer.Set("writer-" + to_string(i), "world", "world", pose);
+                writer.Commit();
+            }
+
+            auto start = chrono::steady_clock::now() + chrono::milliseconds(200);
+            auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.duration));
+            vector<pid_t> children;
+            vector<int> pipes;
+            for(size_t i = 0; i < readers + writers; i++){
+                int fds[2];
+                if(pipe(fds) != 0){
+                    cerr << "Cannot create a pipe: " << strerror(errno) << endl;
+                    return 1;
+                }
+                pid_t pid = fork();
+                if(pid == 0){
+                    close(fds[0]);
+                    bool writer = i >= readers;
+                    auto result = RunProcess(world_path, writer, writer ? i - readers : i, options.depth, start, deadline);
+                    uint64_t header[3] = {result.latencies.size(), result.busy_retries, result.failures};
+                    WriteAll(fds[1], header, sizeof(header));
+                    WriteAll(fds[1], result.latencies.data(), result.latencies.size() * sizeof(double));
+                    close(fds[1]);
+                    _exit(0);
+                }
+                close(fds[1]);
+                children.push_back(pid);
+                pipes.push_back(fds[0]);
+            }
+
+            ProcessResult read_total, write_total;
+            for(size_t i = 0; i < children.size(); i++){
+                auto& total = i < readers ? read_total : write_total;
+                uint64_t header[3];
+                if(ReadAll(pipes[i], header, sizeof(header))){
+                    size_t offset = total.latencies.size();
+                    total.latencies.resize(offset + header[0]);
+                    if(!ReadAll(pipes[i], total.latencies.data() + offset, header[0] * sizeof(double)))
+                        total.latencies.resize(offset);
+                    total.busy_retries += header[1];
+                    total.failures += header[2];
+                }else{
+                    cerr << "Process " << children[i] << " did not report its results." << endl;
+                }
+                close(pipes[i]);
+                waitpid(children[i], nullptr, 0);
+            }
+            if(readers > 0)
+                Report("read", readers, writers, read_total, options.duration, first);
+            if(writers > 0)
+                Report("write", readers, writers, write_total, options.duration, first);
+        }
+    }
+    for(auto const& suffix : {".db", ".db-wal", ".db-shm"})
+        std::filesystem::remove(world_path + suffix);
+    cout << "\n]}" << endl;
+    return 0;
+}
@@ -4,10 +4,523 @@
 #include <algorithm>
 #include <regex>
 #include <fstream>
+#include <sstream>
+#include <map>
+#include <memory>
+#include <csignal>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <thread>
+#include <cstring>
 #include "Wrt.h"
 #include "argparse.hpp"
 using namespace std;
 
+/*
+* Build a matrix from the string representation of a pose.
+*
+* @param str_pose: String like [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]
+* @param pose: Matrix in which the parsed pose is written.
+* @return: True if the string is a list of 16 real numbers, false otherwise.
+*/
+bool ParsePose(string str_pose, Eigen::Matrix4d& pose){
+    //Pre-process the input string [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]
+    char chars_to_remove[] = "[] \r\n\t";
+    for (unsigned int i = 0; i < strlen(chars_to_remove); ++i){
+        str_pose.erase (remove(str_pose.begin(), str_pose.end(), chars_to_remove[i]), str_pose.end());
+    }
+    //Verify the the input string is now a list of 16 real numbers
+    static const regex pose_regex(R"(^(((\+|-)?([0-9]+)(\.[0-9]+)?),){15}((\+|-)?([0-9]+)(\.[0-9]+)?)$)");
+    if(!regex_match(str_pose, pose_regex))
+        return false;
+    //Extract all the numbers
+    size_t pos = 0;
+    string token;
+    double n[16];
+    int counter = 0;
+    while ((pos = str_pose.find(",")) != string::npos) {
+        token = str_pose.substr(0, pos);
+        n[counter] = stod(token);
+        str_pose.erase(0, pos + 1);
+        counter++;
+    }
+    n[15] = stod(str_pose);
+    //Build the pose matrix
+    pose << n[0],n[1],n[2],n[3], n[4],n[5],n[6],n[7], n[8],n[9],n[10],n[11], n[12],n[13],n[14],n[15];
+    return true;
+}
+
+/*
+* Writes poses to the standard output in one of the supported formats:
+*  - text:   The matrix as printed by Eigen.
+*  - csv:    A comma separated list of 16 numbers in row-major order.
+*  - json:   A JSON object describing the query and its pose, or a JSON array of such objects when many poses are written.
+*  - ndjson: One JSON object per line describing the query and its pose as 16 numbers in row-major order.
+*  - bin:    16 raw little-endian doubles in row-major order, without any separator.
+* Each pose is flushed as soon as it is written such that the output can be consumed while it is produced.
+*/
+class PoseWriter{
+    private:
+        /// Name of the output format.
+        string format;
+        /// Whether many poses are written, such that a JSON array is produced.
+        bool many;
+        /// Number of poses written so far.
+        size_t count;
+    public:
+        /*
+        * @param format: One of text, csv, json, ndjson or bin.
+        * @param many: Whether more than one pose can be written.
+        */
+        PoseWriter(string format, bool many): format(format), many(many), count(0){
+            if(format != "text" && format != "csv" && format != "json" && format != "ndjson" && format != "bin")
+                throw runtime_error("Unknown output format "+format+", must be one of text, csv, json, ndjson or bin.");
+        }
+        ~PoseWriter(){
+            if(this->format == "json" && this->many)
+                cout << (this->count == 0 ? "[" : "") << "]" << endl;
+        }
+        /*
+        * Write the pose resulting from a query.
+        */
+        void Write(const Eigen::Matrix4d& pose, const string& world_name, const string& subject_name, const string& basis_name, const string& csys_name){
+            Eigen::Matrix<double, 4, 4, Eigen::RowMajor> n = pose;
+            if(this->format == "text"){
+                cout << pose.matrix() << endl;
+            }else if(this->format == "csv"){
+                for(int i = 0; i < 16; i++)
+                    cout << n.data()[i] << (i < 15 ? "," : "");
+                cout << endl;
+            }else if(this->format == "bin"){
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                for(int i = 0; i < 16; i++){
+                    uint64_t bits;
+                    memcpy(&bits, &n.data()[i], sizeof(bits));
+                    bits = __builtin_bswap64(bits);
+                    memcpy(&n.data()[i], &bits, sizeof(bits));
+                }
+#endif
+                cout.write(reinterpret_cast<const char*>(n.data()), 16 * sizeof(double));
+                cout.flush();
+            }else{
+                if(this->format == "json" && this->many)
+                    cout << (this->count == 0 ? "[" : ",");
+                cout << "{\"In\":\"" << world_name << "\",\"Get\":\"" << subject_name << "\",\"Wrt\":\"" << basis_name << "\",\"Ei\":\"" << csys_name << "\",\"pose\":[";
+                //Shortest representation that reads back to the exact same double.
+                char number[32];
+                for(int i = 0; i < 16; i++){
+                    auto end = to_chars(number, number + sizeof(number), n.data()[i]).ptr;
+                    cout.write(number, end - number) << (i < 15 ? "," : "");
+                }
+                cout << "]}";
+                if(this->format == "ndjson" || !this->many)
+                    cout << endl;
+                else
+                    cout << flush;
+            }
+            this->count++;
+        }
+};
+
+/*
+* Execute one Get/Set command per line, such as "--In test --Get d --Wrt a --Ei a". The leading dashes are optional
+* and --In can be omitted if a default world is given. --As must be the last argument of a line.
+* A single connection is opened per world and the compiled queries are reused when a command is repeated.
+*
+* @param input: Stream from which the commands are read.
+* @param wrt: Connector used to open the worlds.
+* @param client: If not null, the commands are forwarded to the daemon instead of being executed locally.
+* @param default_world: World to use when a line does not specify --In, can be empty.
+* @param writer: Used to write the poses.
+* @param quiet: If true, errors are not reported on the standard error.
+* @param print_stats: If true, the statistics of each world used are written to the standard error, as JSON, once all
+*  the commands ran. The connector must collect them, see DbConnector::COLLECT_STATS.
+* @return: 0 if all commands succeeded, 1 otherwise.
+*/
+int RunBatch(istream& input, DbConnector& wrt, DaemonClient* client, string default_world, PoseWriter& writer, bool quiet, bool print_stats){
+    map<string, GetSet> worlds;
+    map<string, CompiledGet> getters;
+    map<string, CompiledSet> setters;
+    int status = 0;
+    int line_number = 0;
+    string line;
+    while(getline(input, line)){
+        line_number++;
+        //Skip empty lines and comments
+        auto first = line.find_first_not_of(" \t\r");
+        if(first == string::npos || line[first] == '#')
+            continue;
+        try{
+            istringstream tokens(line);
+            map<string, string> args;
+            string key;
+            while(tokens >> key){
+                //Remove the leading dashes
+                key.erase(0, key.find_first_not_of('-'));
+                if(key == "As"){
+                    //The pose can contain spaces so the rest of the line is used.
+                    getline(tokens, args[key]);
+                    break;
+                }
+                if(!(tokens >> args[key]))
+                    throw runtime_error("Missing value for "+key+".");
+            }
+            for(auto const& [k, v] : args){
+                if(k != "In" && k != "Get" && k != "Set" && k != "Wrt" && k != "Ei" && k != "As")
+                    throw runtime_error("Unknown argument "+k+".");
+            }
+            string world_name = args.count("In") ? args["In"] : default_world;
+            if(world_name.empty())
+                throw runtime_error("Must specify --In.");
+            if(args.count("Get") == args.count("Set"))
+                throw runtime_error("Must specify either --Get or --Set.");
+            if(!args.count("Wrt") || !args.count("Ei"))
+                throw runtime_error("Must specify --Wrt and --Ei.");
+
+            if(client != nullptr){
+                if(args.count("Get")){
+                    writer.Write(client->Get(world_name, args["Get"], args["Wrt"], args["Ei"]), world_name, args["Get"], args["Wrt"], args["Ei"]);
+                }else{
+                    Eigen::Matrix4d pose;
+                    if(!args.count("As") || !ParsePose(args["As"], pose))
+                        throw runtime_error("Must specify --As with a list of 16 real numbers when using --Set.");
+                    client->Set(world_name, args["Set"], args["Wrt"], args["Ei"], pose);
+                }
+                continue;
+            }
+
+            auto world = worlds.find(world_name);
+            if(world == worlds.end())
+                world = worlds.emplace(world_name, wrt.In(world_name)).first;
+
+            if(args.count("Get")){
+                string query = world_name+" "+args["Get"]+" "+args["Wrt"]+" "+args["Ei"];
+                auto getter = getters.find(query);
+                if(getter == getters.end())
+                    getter = getters.emplace(query, world->second.Get(args["Get"]).Wrt(args["Wrt"]).Compile(args["Ei"])).first;
+                writer.Write(getter->second(), world_name, args["Get"], args["Wrt"], args["Ei"]);
+            }else{
+                if(!args.count("As"))
+                    throw runtime_error("Must specify --As when using --Set.");
+                Eigen::Matrix4d pose;
+                if(!ParsePose(args["As"], pose))
+                    throw runtime_error("The pose must be a list of 16 real numbers.");
+                string query = world_name+" "+args["Set"]+" "+args["Wrt"]+" "+args["Ei"];
+                auto setter = setters.find(query);
+                if(setter == setters.end())
+                    setter = setters.emplace(query, world->second.Set(args["Set"]).Wrt(args["Wrt"]).Ei(args["Ei"]).Compile()).first;
+                setter->second.As(pose);
+            }
+        }catch (const std::runtime_error& err) {
+            status = 1;
+            if(!quiet)
+                cerr << "Line " << line_number << ": " << err.what() << endl;
+        }
+    }
+    if(print_stats)
+        for(auto& [world_name, world] : worlds)
+            cerr << world.Stats().ToJson() << endl;
+    return status;
+}
+
+/*
+* Read the real numbers found in a string, ignoring brackets, commas and spaces.
+*
+* @param text: String containing the numbers, such as [[1,0,0,0],[0,1,0,0],...].
+* @param numbers: Array receiving the numbers.
+* @param max_count: Size of the array.
+* @return: The number of numbers read, or max_count + 1 if there are too many or if something else than a number is found.
+*/
+size_t ParseNumbers(string_view text, double* numbers, size_t max_count){
+    size_t count = 0;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while(p < end){
+        if(*p == '[' || *p == ']' || *p == ',' || *p == ' ' || *p == '\t' || *p == '\r'){
+            p++;
+            continue;
+        }
+        if(count == max_count)
+            return max_count + 1;
+        //from_chars does not accept a leading plus sign
+        if(*p == '+')
+            p++;
+        auto [next, error] = from_chars(p, end, numbers[count]);
+        if(error != errc())
+            return max_count + 1;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+/*
+* Parse a line of a CSV log of poses: frame,parent,16 numbers in row-major order. An additional column after the parent 
+* can specify the frame in which the pose is expressed, otherwise the pose is expressed in the parent frame.
+* The last row of the matrix can be omitted, in which case it is [0,0,0,1].
+*
+* @return: False if the line is malformed.
+*/
+bool ParseCsvPose(string_view line, string& subject_name, string& basis_name, string& csys_name, Eigen::Matrix4d& pose){
+    //The number of fields tells if the csys column is present and if the last row of the matrix is omitted.
+    size_t n_fields = count(line.begin(), line.end(), ',') + 1;
+    size_t n_names = (n_fields == 19 || n_fields == 15) ? 3 : 2;
+    string_view fields[3];
+    size_t start = 0;
+    for(size_t i = 0; i < n_names; i++){
+        size_t comma = line.find(',', start);
+        if(comma == string_view::npos)
+            return false;
+        fields[i] = line.substr(start, comma - start);
+        start = comma + 1;
+    }
+    double n[16] = {0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,1};
+    size_t count = ParseNumbers(line.substr(start), n, 16);
+    if(count != 16 && count != 12)
+        return false;
+    subject_name = fields[0];
+    basis_name   = fields[1];
+    csys_name    = n_names == 3 ? fields[2] : fields[1];
+    pose << n[0],n[1],n[2],n[3], n[4],n[5],n[6],n[7], n[8],n[9],n[10],n[11], n[12],n[13],n[14],n[15];
+    return true;
+}
+
+/*
+* Parse a line of a NDJSON log of poses: {"frame":"a","parent":"world","pose":[16 numbers]}. The keys Set/Get and Wrt 
+* can be used instead of frame and parent, and the optional Ei key specifies the frame in which the pose is expressed, 
+* such that the output of --format ndjson can be imported directly. The pose can be a flat or nested array.
+*
+* @return: False if the line is malformed.
+*/
+bool ParseNdjsonPose(string_view line, string& subject_name, string& basis_name, string& csys_name, Eigen::Matrix4d& pose){
+    subject_name.clear();
+    basis_name.clear();
+    csys_name.clear();
+    bool has_pose = false;
+    size_t p = line.find('{');
+    while(p != string_view::npos && p < line.size()){
+        //Find the next key
+        size_t key_start = line.find('"', p);
+        if(key_start == string_view::npos)
+            break;
+        size_t key_end = line.find('"', key_start + 1);
+        size_t colon = line.find(':', key_end);
+        if(key_end == string_view::npos || colon == string_view::npos)
+            return false;
+        string_view key = line.substr(key_start + 1, key_end - key_start - 1);
+        size_t value_start = line.find_first_not_of(" \t", colon + 1);
+        if(value_start == string_view::npos)
+            return false;
+        size_t value_end;
+        if(line[value_start] == '"'){
+            value_end = line.find('"', value_start + 1);
+            if(value_end == string_view::npos)
+                return false;
+            string_view value = line.substr(value_start + 1, value_end - value_start - 1);
+            if(key == "frame" || key == "Set" || key == "Get")
+                subject_name = value;
+            else if(key == "parent" || key == "Wrt")
+                basis_name = value;
+            else if(key == "Ei")
+                csys_name = value;
+            value_end++;
+        }else if(line[value_start] == '['){
+            //Find the matching closing bracket
+            int depth = 0;
+            for(value_end = value_start; value_end < line.size(); value_end++){
+                if(line[value_end] == '[')
+                    depth++;
+                if(line[value_end] == ']' && --depth == 0)
+                    break;
+            }
+            if(depth != 0)
+                return false;
+            value_end++;
+            if(key == "pose"){
+                double n[16] = {0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,1};
+                size_t count = ParseNumbers(line.substr(value_start, value_end - value_start), n, 16);
+                if(count != 16 && count != 12)
+                    return false;
+                pose << n[0],n[1],n[2],n[3], n[4],n[5],n[6],n[7], n[8],n[9],n[10],n[11], n[12],n[13],n[14],n[15];
+                has_pose = true;
+            }
+        }else{
+            //Any other value is ignored
+            value_end = line.find_first_of(",}", value_start);
+        }
+        p = value_end;
+    }
+    if(csys_name.empty())
+        csys_name = basis_name;
+    return has_pose && !subject_name.empty() && !basis_name.empty();
+}
+
+/*
+* Set all the poses of a CSV or NDJSON log, committing them in large transactions.
+*
+* @param input: Stream from which the log is read.
+* @param world: World in which the poses are set.
+* @param format: csv, ndjson or auto to decide based on the first line.
+* @param rows_per_transaction: Number of poses written between two commits.
+* @param quiet: If true, neither the errors nor the throughput are reported on the standard error.
+* @return: 0 if all poses were set, 1 otherwise.
+*/
+int RunImport(istream& input, GetSet world, string format, size_t rows_per_transaction, bool quiet){
+    auto start = chrono::steady_clock::now();
+    BulkWriter writer(world, rows_per_transaction);
+    int status = 0;
+    size_t line_number = 0;
+    string line, subject_name, basis_name, csys_name;
+    Eigen::Matrix4d pose;
+    while(getline(input, line)){
+        line_number++;
+        auto first = line.find_first_not_of(" \t\r");
+        if(first == string::npos || line[first] == '#')
+            continue;
+        if(format == "auto")
+            format = line[first] == '{' ? "ndjson" : "csv";
+        try{
+            bool valid = format == "ndjson" ? ParseNdjsonPose(line, subject_name, basis_name, csys_name, pose) : ParseCsvPose(line, subject_name, basis_name, csys_name, pose);
+            if(!valid){
+                //The first line of a CSV file can be a header.
+                if(format == "csv" && line_number == 1)
+                    continue;
+                throw runtime_error("Malformed line, expected frame, parent and 16 numbers.");
+            }
+            writer.Set(subject_name, basis_name, csys_name, pose);
+        }catch (const std::runtime_error& err) {
+            status = 1;
+            if(!quiet)
+                cerr << "Line " << line_number << ": " << err.what() << endl;
+        }
+    }
+    writer.Commit();
+    if(!quiet){
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << "Imported " << writer.Count() << " poses in " << seconds << " s (" << (size_t)(writer.Count() / max(seconds, 1e-9)) << " poses/s)." << endl;
+    }
+    return status;
+}
+
+//Daemon running in this process, if any, such that it can be stopped by a signal.
+Daemon* running_daemon = nullptr;
+
+void StopDaemon(int){
+    if(running_daemon != nullptr)
+        running_daemon->Stop();
+}
+
+//Set by a signal to stop compacting the history of a world.
+volatile sig_atomic_t stop_compacting = 0;
+
+void StopCompacting(int){
+    stop_compacting = 1;
+}
+
+/*
+* Parse a retention policy written as resolution:duration pairs separated by commas, such as 0:60,1:3600,60:86400.
+*/
+vector<RetentionLevel> ParseRetention(const string& policy){
+    vector<RetentionLevel> levels;
+    stringstream stream(policy);
+    string level;
+    while(getline(stream, level, ',')){
+        double values[2];
+        auto separator = level.find(':');
+        if(separator == string::npos || ParseNumbers(string_view(level).substr(0, separator), values, 1) != 1 || ParseNumbers(string_view(level).substr(separator + 1), values + 1, 1) != 1)
+            throw runtime_error("Malformed retention level "+level+", expected resolution:duration in seconds.");
+        levels.push_back({values[0], values[1]});
+    }
+    return levels;
+}
+
+/*
+* Add the arguments setting up the connections to the database to a command.
+*/
+void AddConnectionArguments(argparse::ArgumentParser& parser){
+    parser.add_argument("--profile")
+        .help("Settings of the connections to the database: default, read (mostly getting poses) or write (mostly setting poses). The commands using it access the database directly, even with --daemon.")
+        .default_value(string("default"));
+
+    parser.add_argument("--tune")
+        .help("Settings of the connections overriding the profile, as key=value pairs separated by commas, among busy_timeout (ms), busy_backoff_min and busy_backoff_max (delays between retries on a locked world, in us), mmap_size (bytes), cache_size (pages, or KiB if negative), temp_store (default, file or memory), page_size (bytes), locking_mode (normal or exclusive) and validation (strict, tolerant or trusted, how the poses set are checked).");
+}
+
+/*
+* Build the settings of the connections to the database from the --profile and --tune arguments of a command.
+*/
+ConnectionOptions ParseConnectionOptions(argparse::ArgumentParser& parser){
+    auto profile = parser.get<std::string>("--profile");
+    ConnectionOptions options;
+    if(profile == "read")
+        options = ConnectionOptions::ReadOptimized();
+    else if(profile == "write")
+        options = ConnectionOptions::WriteOptimized();
+    else if(profile != "default")
+        throw runtime_error("Unknown connection profile "+profile+", must be one of default, read or write.");
+    if(!parser.is_used("--tune"))
+        return options;
+    stringstream stream(parser.get<std::string>("--tune"));
+    string setting;
+    while(getline(stream, setting, ',')){
+        auto separator = setting.find('=');
+        if(separator == string::npos)
+            throw runtime_error("Malformed connection setting "+setting+", expected key=value.");
+        string key = setting.substr(0, separator);
+        string value = setting.substr(separator + 1);
+        try{
+            if(key == "busy_timeout")
+                options.busy_timeout = stoi(value);
+            else if(key == "busy_backoff_min")
+                options.busy_backoff_min = stoi(value);
+            else if(key == "busy_backoff_max")
+                options.busy_backoff_max = stoi(value);
+            else if(key == "mmap_size")
+                options.mmap_size = stoll(value);
+            else if(key == "cache_size")
+                options.cache_size = stoll(value);
+            else if(key == "page_size")
+                options.page_size = stoi(value);
+            else if(key == "temp_store")
+                options.temp_store = value;
+            else if(key == "locking_mode")
+                options.locking_mode = value;
+            else if(key == "validation")
+                options.validation = value;
+            else
+                throw runtime_error("Unknown connection setting "+key+".");
+        }catch(const std::logic_error& err){
+            throw runtime_error("Malformed connection setting "+setting+", expected an integer.");
+        }
+    }
+    options.Validate();
+    return options;
+}
+
+/*
+* Connect to the daemon if it was asked for with --daemon and it runs the command as this process would.
+*
+* The daemon opens the worlds with its own connection settings, without recording their history, collecting the
+* statistics of this process or storing the poses in single precision, and validates the poses strictly. A command
+* using any of these, or a time, accesses the database directly instead.
+*
+* @param program: Parsed arguments, used to find the socket and the directory of the databases.
+* @return: A connected client or null if the command runs locally.
+* @throw runtime_error: If the daemon was asked for but cannot be reached.
+*/
+unique_ptr<DaemonClient> ConnectToDaemon(argparse::ArgumentParser& program){
+    if(program["--daemon"] == false)
+        return nullptr;
+    for(auto local_argument : {"--At", "--history", "--stats", "--single-precision", "--profile", "--tune"})
+        if(program.is_used(local_argument))
+            return nullptr;
+    auto socket_path = program.is_used("--socket") ? program.get<std::string>("--socket") : Daemon::DefaultSocketPath();
+    //The daemon does not share our working directory.
+    string dir = program.is_used("--dir") ? string(std::filesystem::absolute(program.get<std::string>("--dir"))) : "";
+    return make_unique<DaemonClient>(socket_path, dir);
+}
+
 int main(int argc, char *argv[]) {
 
     argparse::ArgumentParser program("WRT", "0.1.1");
@@ -19,15 +532,43 @@ int main(int argc, char *argv[]) {
 
     program.add_argument("-c","--compact")
         //https://en.wikipedia.org/wiki/Row-_and_column-major_order
-        .help("Output a compact representation of the matrix as a comma separated list of 16 numbers in row-major order.")
+        .help("Output a compact representation of the matrix as a comma separated list of 16 numbers in row-major order. Same as --format csv.")
         .default_value(false)
         .implicit_value(true);
 
+    program.add_argument("-f","--format")
+        .help("Output format of the poses: text, csv, json, ndjson (one JSON object per line) or bin (16 little-endian doubles in row-major order).")
+        .default_value(string("text"));
+
      program.add_argument("-d","--dir")
         .help("Path to the directory in which the database is located.");
 
+    AddConnectionArguments(program);
+
+    program.add_argument("-b","--batch")
+        .help("Read one command per line (e.g. --Get d --Wrt a --Ei a) from the specified file or from the standard input if no file or - is given.")
+        .nargs(0,1)
+        .default_value(string("-"));
+
+    program.add_argument("--serve")
+        .help("Run a daemon answering Get/Set requests over a UNIX domain socket until interrupted.")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--socket")
+        .help("Path to the UNIX domain socket of the daemon (default: $WRT_SOCKET, $XDG_RUNTIME_DIR/wrt.sock or /tmp/wrt-<uid>.sock).");
+
+    program.add_argument("--daemon")
+        .help("Forward the Get/Set commands to the daemon listening on the socket instead of accessing the database directly, unless they use --At, --history, --stats, --single-precision, --profile or --tune.")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--stats")
+        .help("Access the database directly and write the statistics of the Get or Set operation, or of each world used by a batch, to the standard error, as JSON.")
+        .default_value(false)
+        .implicit_value(true);
+
     program.add_argument("--In")
-        .required()
         .help("The world name the frame lives in ([a-z][0-9]-).");
 
     program.add_argument("--Get")
@@ -37,16 +578,100 @@ int main(int argc, char *argv[]) {
         .help("Name of the frame to set ([a-z][0-9]-).");
 
     program.add_argument("--Wrt")
-        .required()
         .help("Name of the reference frame the frame is described with respect to ([a-z][0-9]-).");
     
     program.add_argument("--Ei")
-        .required()
         .help("Name of the reference frame the frame is expressed in ([a-z][0-9]-).");
     
+    program.add_argument("--At")
+        .help("Time in seconds since the epoch at which the pose is got from the history of the world, or from which the pose set is valid.")
+        .scan<'g', double>();
+
+    program.add_argument("--history")
+        .help("Record the history of the poses of the world, needed to use --At when getting a pose.")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--single-precision")
+        .help("Store the poses of a world created by this command in single precision, which halves the size of its frames.")
+        .default_value(false)
+        .implicit_value(true);
+
     program.add_argument("--As")
         .help("If setting a frame, a string representation of the array defining the pose with rotation R and translation t: [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]");
 
+    argparse::ArgumentParser import_command("import");
+    import_command.add_description("Set all the poses listed in a CSV (frame,parent,16 numbers) or NDJSON ({\"frame\":...,\"parent\":...,\"pose\":[...]}) log, or replace the whole world by a binary snapshot.");
+
+    import_command.add_argument("file")
+        .help("Path to the log, or - to read the standard input.")
+        .nargs(0,1)
+        .default_value(string("-"));
+
+    import_command.add_argument("--In")
+        .required()
+        .help("The world name the frames live in ([a-z][0-9]-).");
+
+    import_command.add_argument("-d","--dir")
+        .help("Path to the directory in which the database is located.");
+
+    import_command.add_argument("-f","--format")
+        .help("Format of the log: csv, ndjson, snapshot or auto to detect it from the beginning of the file.")
+        .default_value(string("auto"));
+
+    AddConnectionArguments(import_command);
+
+    import_command.add_argument("--transaction-size")
+        .help("Number of poses written between two commits.")
+        .default_value(size_t(100000))
+        .scan<'u', size_t>();
+
+    import_command.add_argument("-q","--quiet")
+        .help("Do not report the errors and the throughput.")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_subparser(import_command);
+
+    argparse::ArgumentParser export_command("export");
+    export_command.add_description("Write a binary snapshot of a world, which can be loaded back with the import command.");
+
+    export_command.add_argument("file")
+        .required()
+        .help("Path to the snapshot.");
+
+    export_command.add_argument("--In")
+        .required()
+        .help("The world name the frames live in ([a-z][0-9]-).");
+
+    export_command.add_argument("-d","--dir")
+        .help("Path to the directory in which the database is located.");
+
+    AddConnectionArguments(export_command);
+
+    program.add_subparser(export_command);
+
+    argparse::ArgumentParser compact_command("compact");
+    compact_command.add_description("Apply the retention policy of a world that records its history: decimate the old samples into the coarser levels and drop the oldest ones.");
+
+    compact_command.add_argument("--In")
+        .required()
+        .help("The world name the frames live in ([a-z][0-9]-).");
+
+    compact_command.add_argument("-d","--dir")
+        .help("Path to the directory in which the database is located.");
+
+    AddConnectionArguments(compact_command);
+
+    compact_command.add_argument("--retention")
+        .help("New retention policy as resolution:duration pairs in seconds, from the finest to the coarsest, e.g. 0:60,1:3600,60:86400.");
+
+    compact_command.add_argument("--watch")
+        .help("Keep compacting the history every specified number of seconds until interrupted.")
+        .scan<'g', double>();
+
+    program.add_subparser(compact_command);
+
     try {
         program.parse_args(argc, argv);
     }
@@ -56,9 +681,166 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
+    //Import a log of poses
+    if(program.is_subcommand_used(import_command)){
+        bool quiet = import_command["--quiet"] == true;
+        auto format = import_command.get<std::string>("--format");
+        if(format != "auto" && format != "csv" && format != "ndjson" && format != "snapshot"){
+            cerr << "Error: Unknown log format " << format << ", must be one of csv, ndjson, snapshot or auto." << endl;
+            exit(1);
+        }
+        try{
+            string dir = import_command.is_used("--dir") ? import_command.get<std::string>("--dir") : "";
+            DbConnector wrt(dir, 0, ParseConnectionOptions(import_command));
+            auto world = wrt.In(import_command.get<std::string>("--In"));
+            auto transaction_size = max(import_command.get<size_t>("--transaction-size"), size_t(1));
+            auto path = import_command.get<std::string>("file");
+            if(path == "-"){
+                if(format == "snapshot")
+                    throw runtime_error("A snapshot cannot be read from the standard input.");
+                return RunImport(cin, world, format, transaction_size, quiet);
+            }
+            ifstream file(path, ios::binary);
+            if(!file.is_open())
+                throw runtime_error("Cannot open "+path+".");
+            if(format == "auto"){
+                char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+                file.read(magic, sizeof(magic));
+                if(file.gcount() == sizeof(magic) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0)
+                    format = "snapshot";
+                file.clear();
+                file.seekg(0);
+            }
+            if(format == "snapshot"){
+                world.Import(path);
+                return 0;
+            }
+            return RunImport(file, world, format, transaction_size, quiet);
+        }catch (const std::runtime_error& err) {
+            if(!quiet)
+                cerr << err.what() << endl;
+            exit(1);
+        }
+    }
+
+    //Compact the history of a world
+    if(program.is_subcommand_used(compact_command)){
+        try{
+            string dir = compact_command.is_used("--dir") ? compact_command.get<std::string>("--dir") : "";
+            DbConnector wrt(dir, 0, ParseConnectionOptions(compact_command));
+            auto world = wrt.In(compact_command.get<std::string>("--In"));
+            if(compact_command.is_used("--retention"))
+                world.SetRetention(ParseRetention(compact_command.get<std::string>("--retention")));
+            Compactor compactor(world);
+            signal(SIGINT, StopCompacting);
+            signal(SIGTERM, StopCompacting);
+            do{
+                while(!stop_compacting && compactor.Step());
+                if(!compact_command.is_used("--watch"))
+                    break;
+                //Sleep in short increments to notice an interruption quickly.
+                auto wake_up = chrono::steady_clock::now() + chrono::duration<double>(compact_command.get<double>("--watch"));
+                while(!stop_compacting && chrono::steady_clock::now() < wake_up)
+                    this_thread::sleep_for(chrono::milliseconds(100));
+            }while(!stop_compacting);
+            return 0;
+        }catch (const std::runtime_error& err) {
+            cerr << err.what() << endl;
+            exit(1);
+        }
+    }
+
+    //Export a snapshot of a world
+    if(program.is_subcommand_used(export_command)){
+        try{
+            string dir = export_command.is_used("--dir") ? export_command.get<std::string>("--dir") : "";
+            DbConnector wrt(dir, 0, ParseConnectionOptions(export_command));
+            wrt.In(export_command.get<std::string>("--In")).Export(export_command.get<std::string>("file"));
+            return 0;
+        }catch (const std::runtime_error& err) {
+            cerr << err.what() << endl;
+            exit(1);
+        }
+    }
+
+    auto output_format = program["--compact"] == true ? string("csv") : program.get<std::string>("--format");
+    try{
+        PoseWriter validate_format(output_format, false);
+    }catch (const std::runtime_error& err) {
+        cerr << "Error: " << err.what() << endl;
+        exit(1);
+    }
+
+    ConnectionOptions connection_options;
+    try{
+        connection_options = ParseConnectionOptions(program);
+    }catch (const std::runtime_error& err) {
+        cerr << "Error: " << err.what() << endl;
+        exit(1);
+    }
+    string dir_path = program.is_used("--dir") ? program.get<std::string>("--dir") : "";
+
+    auto record_history = program["--history"] == true;
+    auto collect_stats = program["--stats"] == true;
+    uint8_t flags = record_history ? DbConnector::RECORD_HISTORY : 0;
+    if(collect_stats)
+        flags |= DbConnector::COLLECT_STATS;
+    auto single_precision = program["--single-precision"] == true;
+    if(single_precision)
+        flags |= DbConnector::SINGLE_PRECISION;
+
+    //Run the daemon until interrupted.
+    if(program["--serve"] == true){
+        try{
+            Daemon daemon(program.is_used("--socket") ? program.get<std::string>("--socket") : Daemon::DefaultSocketPath());
+            running_daemon = &daemon;
+            signal(SIGINT, StopDaemon);
+            signal(SIGTERM, StopDaemon);
+            daemon.Serve();
+            running_daemon = nullptr;
+        }catch (const std::runtime_error& err) {
+            if(program["--quiet"] == false)
+                cerr << err.what() << endl;
+            exit(1);
+        }
+        return 0;
+    }
+
+    //In batch mode, the commands are read from a file or the standard input.
+    if(program.is_used("--batch")){
+        DbConnector wrt(dir_path, flags, connection_options);
+        string default_world = program.is_used("--In") ? program.get<std::string>("--In") : "";
+        bool quiet = program["--quiet"] == true;
+        unique_ptr<DaemonClient> client;
+        try{
+            client = ConnectToDaemon(program);
+        }catch (const std::runtime_error& err) {
+            if(!quiet)
+                cerr << "Error: " << err.what() << endl;
+            exit(1);
+        }
+        auto path = program.get<std::string>("--batch");
+        PoseWriter writer(output_format, true);
+        if(path == "-")
+            return RunBatch(cin, wrt, client.get(), default_world, writer, quiet, collect_stats);
+        ifstream file(path);
+        if(!file.is_open()){
+            if(!quiet)
+                cerr << "Error: Cannot open " << path << "." << endl;
+            exit(1);
+        }
+        return RunBatch(file, wrt, client.get(), default_world, writer, quiet, collect_stats);
+    }
+
+    if(!program.is_used("--In") || !program.is_used("--Wrt") || !program.is_used("--Ei")){
+        cerr << "Error: Must specify --In, --Wrt and --Ei." << endl;
+        exit(1);
+    }
+
     auto has_get = program.is_used("--Get");
     auto has_set = program.is_used("--Set");
     auto has_as  = program.is_used("--As");
+    auto has_at  = program.is_used("--At");
 
     if(has_get && has_set){
         cerr << "Error: Cannot use both --Get and --Set, only one or the other." << endl;
@@ -81,45 +863,30 @@ int main(int argc, char *argv[]) {
         if(has_set){
             //Build a matrix from the string representation of the pose
             auto str_pose = program.get<std::string>("--As");
-            //Pre-process the input string [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]
-            char chars_to_remove[] = "[] \r\n\t";
-            for (unsigned int i = 0; i < strlen(chars_to_remove); ++i){
-                str_pose.erase (remove(str_pose.begin(), str_pose.end(), chars_to_remove[i]), str_pose.end());
-            }
-            //Verify the the input string is now a list of 16 real numbers
-            auto valid = regex_match(str_pose, regex(R"(^(((\+|-)?([0-9]+)(\.[0-9]+)?),){15}((\+|-)?([0-9]+)(\.[0-9]+)?)$)"));
+            Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+            auto valid = ParsePose(str_pose, pose);
             
             if(valid){
-                //Extract all the numbers
-                size_t pos = 0;
-                string token;
-                double n[16];
-                int counter = 0;
-                while ((pos = str_pose.find(",")) != string::npos) {
-                    token = str_pose.substr(0, pos);
-                    n[counter] = stod(token);
-                    str_pose.erase(0, pos + 1);
-                    counter++;
-                }
-                n[15] = stod(str_pose);
-                //Build the pose matrix
-                Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
-                pose << n[0],n[1],n[2],n[3], n[4],n[5],n[6],n[7], n[8],n[9],n[10],n[11], n[12],n[13],n[14],n[15];
                 //Retrieve pertinent arguments
                 auto world_name     = program.get<std::string>("--In");
                 auto subject_name     = program.get<std::string>("--Set");
                 auto basis_name = program.get<std::string>("--Wrt");
                 auto csys_name  = program.get<std::string>("--Ei");
-                //Set pose
-                DbConnector wrt;
-                if(program.is_used("--dir")){
-                    string dir_path = program.get<std::string>("--dir");
-                    wrt = DbConnector(dir_path, 0);
-                    cout << "called constructor with path." << endl;
-                }else{
-                    wrt = DbConnector();
+                //Set pose, through the daemon if asked for.
+                auto client = ConnectToDaemon(program);
+                if(client){
+                    client->Set(world_name, subject_name, basis_name, csys_name, pose);
+                    return 0;
                 }
-                wrt.In(world_name).Set(subject_name).Wrt(basis_name).Ei(csys_name).As(pose);
+                DbConnector wrt(dir_path, flags, connection_options);
+                auto world = wrt.In(world_name);
+                auto query = world.Set(subject_name).Wrt(basis_name).Ei(csys_name);
+                if(has_at)
+                    query.As(pose, program.get<double>("--At"));
+                else
+                    query.As(pose);
+                if(collect_stats)
+                    cerr << world.Stats().ToJson() << endl;
             }
         }
         
@@ -130,26 +897,21 @@ int main(int argc, char *argv[]) {
             auto subject_name     = program.get<std::string>("--Get");
             auto basis_name = program.get<std::string>("--Wrt");
             auto csys_name  = program.get<std::string>("--Ei");
-            //Get pose
-            DbConnector wrt;
-            if(program.is_used("--dir")){
-                string dir_path = program.get<std::string>("--dir");
-                wrt = DbConnector(dir_path, 0);
-            }else{
-                wrt = DbConnector();
-            }
-            Eigen::Matrix4d pose = wrt.In(world_name).Get(subject_name).Wrt(basis_name).Ei(csys_name);
-
-            //If the output should be compact
-            if(program["--compact"] == true){
-                auto n = pose;
-                cout << n(0,0) << "," << n(0,1) << "," << n(0,2) << "," << n(0,3) << ",";
-                cout << n(1,0) << "," << n(1,1) << "," << n(1,2) << "," << n(1,3) << ",";
-                cout << n(2,0) << "," << n(2,1) << "," << n(2,2) << "," << n(2,3) << ",";
-                cout << n(3,0) << "," << n(3,1) << "," << n(3,2) << "," << n(3,3) << endl;
-            }else{
-                cout << pose.matrix() << endl;
+            //Get pose, through the daemon if asked for.
+            auto client = ConnectToDaemon(program);
+            if(client){
+                PoseWriter(output_format, false).Write(client->Get(world_name, subject_name, basis_name, csys_name), world_name, subject_name, basis_name, csys_name);
+                return 0;
             }
+            DbConnector wrt(dir_path, flags, connection_options);
+            auto world = wrt.In(world_name);
+            auto query = world.Get(subject_name).Wrt(basis_name);
+            Eigen::Matrix4d pose = has_at ? query.At(program.get<double>("--At")).Ei(csys_name) : query.Ei(csys_name);
+
+            //Write the pose in the requested format
+            PoseWriter(output_format, false).Write(pose, world_name, subject_name, basis_name, csys_name);
+            if(collect_stats)
+                cerr << world.Stats().ToJson() << endl;
         }
     }catch (const std::runtime_error& err) {
         if(program["--quiet"] == true){
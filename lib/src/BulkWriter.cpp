@@ -0,0 +1,72 @@
+#include "BulkWriter.h"
+#include "Busy.h"
+using namespace std;
+
+BulkWriter::BulkWriter(GetSet world, size_t rows_per_transaction):
+    world(world),
+    rows_per_transaction(rows_per_transaction),
+    rows_in_transaction(0),
+    total_rows(0),
+    in_transaction(false){
+    this->db = this->world.Connection();
+    this->stats = StatsCollector::Find(this->world.world_name);
+    //The write lock is taken right away: SQLite does not wait for it when a transaction that already read upgrades to a
+    // write, which would make the writes fail as soon as another connection writes.
+    this->begin_query = make_unique<SQLite::Statement>(*this->db, "BEGIN IMMEDIATE");
+    this->commit_query = make_unique<SQLite::Statement>(*this->db, "COMMIT");
+}
+
+BulkWriter::~BulkWriter(){
+    if(this->in_transaction){
+        try{
+            this->db->exec("ROLLBACK");
+        }catch(...){}
+    }
+}
+
+void BulkWriter::Set(const string& subject_name, const string& basis_name, const string& csys_name, const Eigen::Matrix4d& pose){
+    if(!this->in_transaction){
+        this->begin_query->reset();
+        try{
+            this->begin_query->executeStep();
+        }catch(const SQLite::Exception& err){
+            RethrowBusy(err, this->world.world_name);
+        }
+        this->in_transaction = true;
+        WRT_TRACE(begin, this->world.world_name.c_str(), "bulk", 0);
+    }
+
+    //Logs usually contain few distinct frames so the compiled queries are kept, within reason.
+    string key = subject_name+" "+basis_name+" "+csys_name;
+    auto setter = this->setters.find(key);
+    if(setter == this->setters.end()){
+        if(this->setters.size() >= 10000)
+            this->setters.clear();
+        setter = this->setters.emplace(key, this->world.Set(subject_name).Wrt(basis_name).Ei(csys_name).Compile()).first;
+    }
+    setter->second.As(pose);
+
+    this->total_rows++;
+    if(++this->rows_in_transaction >= this->rows_per_transaction)
+        this->Commit();
+}
+
+void BulkWriter::Commit(){
+    if(this->in_transaction){
+        this->commit_query->reset();
+        try{
+            this->commit_query->executeStep();
+        }catch(const SQLite::Exception& err){
+            RethrowBusy(err, this->world.world_name);
+        }
+        this->in_transaction = false;
+        WRT_TRACE(commit, this->world.world_name.c_str(), "bulk", 0);
+        if(this->stats)
+            this->stats->commits++;
+    }
+    this->rows_in_transaction = 0;
+}
+
+size_t BulkWriter::Count(){
+    return this->total_rows;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+//Forward declaration
+class BulkWriter;
+
+#include "GetSet.h"
+#include "ExpressedIn.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <Eigen/Eigen>
+#include <string>
+#include <map>
+#include <memory>
+using namespace std;
+
+/**
+ * @brief Sets a large number of frames by grouping the writes in large transactions.
+ * 
+ * Each call to Set() behaves like In("world").Set(subject).Wrt(basis).Ei(csys).As(pose) but the transaction is
+ * only committed every rows_per_transaction poses, which makes ingesting logs of poses much faster. Each transaction
+ * takes the write lock right away, waiting for the other writers as a Set() does, see ConnectionOptions::busy_timeout.
+ * 
+ * Example:
+ * 
+ *     auto writer = BulkWriter(wrt.In("lab"));
+ *     for(auto const& [frame, parent, pose] : log)
+ *         writer.Set(frame, parent, parent, pose);
+ *     writer.Commit();
+ */
+class BulkWriter
+{
+    private:
+        /// World in which the frames are set.
+        GetSet world;
+        /// Connection to the database of the world.
+        shared_ptr<SQLite::Database> db;
+        /// Prepared statements starting and committing the transactions in which the poses are written.
+        unique_ptr<SQLite::Statement> begin_query, commit_query;
+        /// Whether a transaction is running, rolled back when the object is destroyed.
+        bool in_transaction;
+        /// Number of poses written before the transaction is committed.
+        size_t rows_per_transaction;
+        /// Number of poses written in the current transaction.
+        size_t rows_in_transaction;
+        /// Number of poses written since the creation of the object.
+        size_t total_rows;
+        /// Compiled queries indexed by subject, basis and csys names.
+        map<string, CompiledSet> setters;
+        /// Statistics of the world, only if they are collected, see DbConnector::COLLECT_STATS.
+        shared_ptr<StatsCollector> stats;
+    public:
+        /**
+         * @brief Prepare to write many frames to a world.
+         * 
+         * @param world: World to write to, as returned by DbConnector::In().
+         * @param rows_per_transaction: Number of poses written between two commits.
+         */
+        BulkWriter(GetSet world, size_t rows_per_transaction = 100000);
+        /**
+         * @brief Destroy the object, rolling back the poses that were not committed.
+         */
+        ~BulkWriter();
+        /**
+         * @brief Set the pose of the subject frame with respect to the basis frame and expressed in the csys frame.
+         * 
+         * @throw TimeoutError: If another connection held the write lock for longer than the busy timeout.
+         * @throw runtime_error: If the query is incorrect or if the transformation matrix is invalid, in which case the pose is not written.
+         */
+        void Set(const string& subject_name, const string& basis_name, const string& csys_name, const Eigen::Matrix4d& pose);
+        /**
+         * @brief Commit the poses written since the last commit.
+         * 
+         * @throw TimeoutError: If a lock needed to commit was not obtained within the busy timeout.
+         */
+        void Commit();
+        /**
+         * @brief Number of poses written since the creation of the object.
+         */
+        size_t Count();
+};
@@ -0,0 +1,72 @@
+#include "Busy.h"
+#include <sqlite3.h>
+#include <thread>
+#include <random>
+using namespace std;
+
+TimeoutError::TimeoutError(const string& message): runtime_error(message){}
+
+//Deadline of the operation running on this thread, see CallDeadline.
+static thread_local chrono::steady_clock::time_point call_deadline = chrono::steady_clock::time_point::max();
+//Whether the last wait for a lock on this thread gave up because its deadline or the busy timeout passed, see RethrowBusy().
+static thread_local bool wait_expired = false;
+
+CallDeadline::CallDeadline(int timeout): previous(call_deadline){
+    if(timeout > 0)
+        call_deadline = min(call_deadline, chrono::steady_clock::now() + chrono::milliseconds(timeout));
+}
+
+CallDeadline::~CallDeadline(){
+    call_deadline = this->previous;
+}
+
+chrono::steady_clock::time_point CallDeadline::Current(){
+    return call_deadline;
+}
+
+WorldConnection::WorldConnection(const string& path, const ConnectionOptions& options, shared_ptr<StatsCollector> stats):
+    SQLite::Database(path, SQLite::OPEN_READWRITE), options(options), stats(stats){
+    //Replaces the handler installed by a busy timeout, which sleeps for fixed delays.
+    sqlite3_busy_handler(this->getHandle(), BusyHandler, this);
+}
+
+int WorldConnection::BusyHandler(void* data, int attempts){
+    auto connection = (WorldConnection*)data;
+    auto now = chrono::steady_clock::now();
+    if(attempts == 0){
+        connection->wait_start = now;
+        wait_expired = false;
+    }
+    auto deadline = min(CallDeadline::Current(), connection->wait_start + chrono::milliseconds(connection->options.busy_timeout));
+    if(now >= deadline){
+        wait_expired = true;
+        return 0;
+    }
+
+    //Exponential backoff from the minimum delay, capped by the maximum delay. The cap decreases as the wait gets longer,
+    // which gives the connections that waited the longest more chances to get the lock once it is released.
+    double min_delay = connection->options.busy_backoff_min;
+    double max_delay = connection->options.busy_backoff_max;
+    double waited = chrono::duration<double, micro>(now - connection->wait_start).count();
+    double cap = max(min_delay, max_delay / (1 + waited / max_delay));
+    double delay = min(cap, min_delay * double(1ull << min(attempts, 30)));
+    //Sleep for a random duration between half the delay and the delay, such that the connections do not retry in lockstep.
+    static thread_local minstd_rand generator(random_device{}());
+    delay *= uniform_real_distribution<double>(0.5, 1.0)(generator);
+    auto wake_up = min(deadline, now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, micro>(delay)));
+
+    if(connection->stats)
+        connection->stats->busy_retries++;
+    this_thread::sleep_until(wake_up);
+    return 1;
+}
+
+void RethrowBusy(const SQLite::Exception& error, const string& world_name){
+    //SQLite also reports SQLITE_BUSY without waiting, e.g. SQLITE_BUSY_SNAPSHOT when a transaction that read an older
+    // state of the world tries to write, which waiting longer would not solve.
+    bool expired = wait_expired;
+    wait_expired = false;
+    if(error.getErrorCode() == SQLITE_BUSY && expired)
+        throw TimeoutError("Timed out waiting for a lock held by another connection to the world "+world_name+".");
+    throw error;
+}
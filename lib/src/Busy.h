@@ -0,0 +1,89 @@
+#pragma once
+
+//Forward declaration
+class WorldConnection;
+class CallDeadline;
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <chrono>
+#include "ConnectionOptions.h"
+#include "Stats.h"
+using namespace std;
+
+/**
+ * @brief Thrown when an operation could not get a lock held by another connection before its deadline, see
+ *  ConnectionOptions::busy_timeout and ExpressedInGet::Within().
+ *
+ * @note Derives from runtime_error, such that code catching every error of the library keeps working.
+ */
+class TimeoutError : public runtime_error{
+    public:
+        TimeoutError(const string& message);
+};
+
+/**
+ * @brief Connection to the database of a world, which waits for the locks held by other connections with a
+ *  jittered exponential backoff. For internal use only, see DbConnector::Connect().
+ *
+ * A wait ends when the lock is obtained, when the busy timeout of the connection elapsed or when the deadline of
+ * the current operation passed, whichever comes first. The random jitter spreads the retries of the writers that
+ * were blocked by the same transaction, and the delay between two retries shrinks as the wait gets longer, such that
+ * the writers that waited the longest are the most likely to get the lock once it is released.
+ */
+class WorldConnection : public SQLite::Database{
+    private:
+        /// Settings of the connection, including the busy timeout and the bounds of the backoff.
+        ConnectionOptions options;
+        /// Statistics of the world, only if they are collected, see DbConnector::COLLECT_STATS.
+        shared_ptr<StatsCollector> stats;
+        /// Time at which the current wait started.
+        chrono::steady_clock::time_point wait_start;
+        /**
+         * @brief Busy handler called by SQLite each time a lock is not available.
+         *
+         * @return int Non-zero to try again after sleeping, zero to give up and report SQLITE_BUSY.
+         */
+        static int BusyHandler(void* data, int attempts);
+    public:
+        /**
+         * @brief Open a connection to an existing database.
+         *
+         * @param path: Path to the database file.
+         * @param options: Settings of the connection.
+         * @param stats: Statistics of the world, or nullptr if they are not collected.
+         */
+        WorldConnection(const string& path, const ConnectionOptions& options, shared_ptr<StatsCollector> stats);
+};
+
+/**
+ * @brief Bounds the time the operations of the current thread wait for locks, until the object is destroyed. For internal use only.
+ *
+ * Deadlines can be nested, in which case the earliest one applies.
+ */
+class CallDeadline{
+    private:
+        /// Deadline in effect before this object was created, restored when it is destroyed.
+        chrono::steady_clock::time_point previous;
+    public:
+        /**
+         * @param timeout: Time in milliseconds the operation can wait for locks, 0 or less for no deadline other than the busy timeout.
+         */
+        CallDeadline(int timeout);
+        ~CallDeadline();
+        /**
+         * @brief Deadline of the operation of the current thread, time_point::max() if there is none.
+         */
+        static chrono::steady_clock::time_point Current();
+};
+
+/**
+ * @brief Throw a TimeoutError instead of the SQLite error if it reports a lock that could not be obtained before the deadline
+ *  or the busy timeout expired, rethrow it otherwise, including the SQLITE_BUSY errors reported without waiting.
+ *
+ * @param error: Error thrown by SQLite.
+ * @param world_name: Path to the database of the world, used in the message.
+ */
+[[noreturn]] void RethrowBusy(const SQLite::Exception& error, const string& world_name);
@@ -0,0 +1,57 @@
+#include "ConnectionOptions.h"
+#include <stdexcept>
+using namespace std;
+
+ConnectionOptions ConnectionOptions::ReadOptimized(){
+    ConnectionOptions options;
+    //Map up to 256 MiB of the database, which serves pages without copying them.
+    options.mmap_size = 268435456;
+    options.cache_size = -65536;
+    options.temp_store = "memory";
+    return options;
+}
+
+ConnectionOptions ConnectionOptions::WriteOptimized(){
+    ConnectionOptions options;
+    options.cache_size = -65536;
+    options.temp_store = "memory";
+    //Larger pages mean fewer pages to write to the WAL per transaction.
+    options.page_size = 8192;
+    return options;
+}
+
+void ConnectionOptions::Validate() const{
+    if(this->busy_timeout < 0)
+        throw runtime_error("The busy timeout cannot be negative.");
+    if(this->busy_backoff_min <= 0 || this->busy_backoff_max < this->busy_backoff_min)
+        throw runtime_error("The backoff delays must be positive, the maximum being at least the minimum.");
+    if(this->mmap_size < 0)
+        throw runtime_error("The mmap size cannot be negative.");
+    if(this->temp_store != "default" && this->temp_store != "file" && this->temp_store != "memory")
+        throw runtime_error("The temp store must be one of default, file or memory, not "+this->temp_store+".");
+    if(this->page_size < 512 || this->page_size > 65536 || (this->page_size & (this->page_size - 1)) != 0)
+        throw runtime_error("The page size must be a power of two between 512 and 65536, not "+to_string(this->page_size)+".");
+    if(this->locking_mode != "normal" && this->locking_mode != "exclusive")
+        throw runtime_error("The locking mode must be either normal or exclusive, not "+this->locking_mode+".");
+    this->ValidationPolicy();
+}
+
+PoseValidation ConnectionOptions::ValidationPolicy() const{
+    if(this->validation == "strict")
+        return PoseValidation::Strict;
+    if(this->validation == "tolerant")
+        return PoseValidation::Tolerant;
+    if(this->validation == "trusted")
+        return PoseValidation::Trusted;
+    throw runtime_error("The validation must be one of strict, tolerant or trusted, not "+this->validation+".");
+}
+
+string ConnectionOptions::Pragmas() const{
+    this->Validate();
+    //The journal mode is stored in the database when the world is created, it does not need to be set again.
+    return "PRAGMA synchronous = off;"
+           "PRAGMA cache_size = "+to_string(this->cache_size)+";"
+           "PRAGMA mmap_size = "+to_string(this->mmap_size)+";"
+           "PRAGMA temp_store = "+this->temp_store+";"
+           "PRAGMA locking_mode = "+this->locking_mode+";";
+}
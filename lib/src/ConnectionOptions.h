@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+using namespace std;
+
+/**
+ * @brief How the poses given to Set() are checked before being stored, see ConnectionOptions::validation.
+ */
+enum class PoseValidation{
+    /// Reject the poses whose rotation is not a rotation matrix up to the rounding errors of their precision.
+    Strict,
+    /// Accept rotations that drifted slightly from a rotation matrix, replaced by the nearest rotation matrix.
+    Tolerant,
+    /// Store the poses without checking them.
+    Trusted
+};
+
+/**
+ * @brief Settings applied once to every connection opened to a world, to tune SQLite for the hardware and the workload.
+ *
+ * The default values are the ones of SQLite, except for the busy timeout. ReadOptimized() and WriteOptimized() are
+ * starting points for processes that mostly get or mostly set poses.
+ *
+ * Example: Reading from memory-mapped databases.
+ *
+ *     auto wrt = DbConnector("", 0, ConnectionOptions::ReadOptimized());
+ *     auto world = wrt.In("laboratory");
+ *
+ * @see https://www.sqlite.org/pragma.html
+ */
+struct ConnectionOptions{
+    /// Time in milliseconds to wait for a lock held by another connection before failing with a TimeoutError.
+    int busy_timeout = 10000;
+    /// Time in microseconds to wait before the first retry when a lock is held by another connection, doubled at each retry.
+    int busy_backoff_min = 100;
+    /// Longest time in microseconds between two retries, shortened as the wait gets longer, see WorldConnection.
+    int busy_backoff_max = 100000;
+    /// Maximum number of bytes of the database accessed through memory mapping instead of read(), 0 to disable it.
+    int64_t mmap_size = 0;
+    /// Size of the page cache of each connection, in pages if positive or in KiB if negative.
+    int64_t cache_size = -2000;
+    /// Where temporary tables and indices are stored: default, file or memory.
+    string temp_store = "default";
+    /// Size in bytes of the pages of a database, a power of two between 512 and 65536. Only used when a world is created.
+    int page_size = 4096;
+    /**
+     * @brief Locking mode of the connections: normal or exclusive.
+     *
+     * @note An exclusive connection keeps the locks it takes until it is closed, which saves system calls but prevents
+     *  any other connection, from this process or another one, from accessing the world meanwhile.
+     */
+    string locking_mode = "normal";
+    /**
+     * @brief How the poses given to Set() are validated: strict, tolerant or trusted.
+     *
+     * strict rejects a matrix whose upper left block deviates from a rotation matrix by more than the rounding errors of
+     * double precision (single precision for Eigen::Isometry3f), or whose last row is not [0,0,0,1]. tolerant accepts
+     * deviations up to 1e-4, such as the drift of rotations composed many times, and stores the nearest rotation matrix
+     * instead. trusted skips the checks, for producers that already guarantee valid rigid transformations: an invalid
+     * pose is then stored as is and corrupts the poses computed from it.
+     */
+    string validation = "strict";
+
+    /**
+     * @brief Settings for processes that mostly get poses: memory-mapped reads, a larger page cache and temporary
+     *  tables in memory.
+     */
+    static ConnectionOptions ReadOptimized();
+    /**
+     * @brief Settings for processes that mostly set poses: a larger page cache, temporary tables in memory and larger pages
+     *  for the worlds created.
+     */
+    static ConnectionOptions WriteOptimized();
+    /**
+     * @brief Check the values of the settings.
+     *
+     * @throw runtime_error: If a setting has an invalid value.
+     */
+    void Validate() const;
+    /**
+     * @brief Policy named by validation.
+     *
+     * @throw runtime_error: If validation is not one of strict, tolerant or trusted.
+     */
+    PoseValidation ValidationPolicy() const;
+    /**
+     * @brief PRAGMA statements setting up a connection with these settings, the page size and busy timeout excluded.
+     */
+    string Pragmas() const;
+};
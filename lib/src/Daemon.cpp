@@ -0,0 +1,342 @@
+#include "Daemon.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+using namespace std;
+
+//Append a string preceded by its length to a message.
+void AppendString(string& message, const string& value){
+    if(value.size() > UINT16_MAX)
+        throw runtime_error("The string "+value.substr(0, 32)+"... is too long to be sent to the daemon.");
+    uint16_t length = value.size();
+    message.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    message.append(value);
+}
+
+//Read a string preceded by its length from a message, starting at offset which is moved past the string.
+string ReadString(const string& message, size_t& offset){
+    uint16_t length;
+    if(offset + sizeof(length) > message.size())
+        throw runtime_error("Malformed request.");
+    memcpy(&length, message.data() + offset, sizeof(length));
+    offset += sizeof(length);
+    if(offset + length > message.size())
+        throw runtime_error("Malformed request.");
+    string value = message.substr(offset, length);
+    offset += length;
+    return value;
+}
+
+//Append a pose as 16 doubles in row-major order to a message.
+void AppendPose(string& message, const Eigen::Matrix4d& pose){
+    Eigen::Matrix<double, 4, 4, Eigen::RowMajor> row_major = pose;
+    message.append(reinterpret_cast<const char*>(row_major.data()), 16 * sizeof(double));
+}
+
+//Read a pose stored as 16 doubles in row-major order from a message.
+Eigen::Matrix4d ReadPose(const string& message, size_t offset){
+    if(offset + 16 * sizeof(double) > message.size())
+        throw runtime_error("Malformed message.");
+    Eigen::Matrix<double, 4, 4, Eigen::RowMajor> row_major;
+    memcpy(row_major.data(), message.data() + offset, 16 * sizeof(double));
+    return row_major;
+}
+
+//Prepend the size of a message to it.
+string Frame(const string& message){
+    uint32_t size = message.size();
+    return string(reinterpret_cast<const char*>(&size), sizeof(size)) + message;
+}
+
+sockaddr_un SocketAddress(const string& socket_path){
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof(address.sun_path))
+        throw runtime_error("The socket path "+socket_path+" is too long.");
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+string Daemon::DefaultSocketPath(){
+    char* path = getenv("WRT_SOCKET");
+    if(path != NULL)
+        return string(path);
+    char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if(runtime_dir != NULL)
+        return string(runtime_dir) + "/wrt.sock";
+    return "/tmp/wrt-" + to_string(getuid()) + ".sock";
+}
+
+Daemon::Daemon(string socket_path, size_t max_worlds, size_t max_queries, int timeout):
+    socket_path(socket_path),
+    stop_requested(false),
+    timeout(timeout),
+    connectors(max_worlds),
+    worlds(max_worlds),
+    getters(max_queries),
+    setters(max_queries){
+    if(DaemonClient::IsRunning(socket_path))
+        throw runtime_error("A daemon is already listening on "+socket_path+".");
+    //Remove a socket left behind by a daemon that did not exit cleanly.
+    unlink(socket_path.c_str());
+
+    sockaddr_un address = SocketAddress(socket_path);
+    this->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(this->listen_fd < 0)
+        throw runtime_error("Cannot create the socket: "+string(strerror(errno)));
+    if(bind(this->listen_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(this->listen_fd, SOMAXCONN) < 0){
+        string error = strerror(errno);
+        close(this->listen_fd);
+        throw runtime_error("Cannot listen on "+socket_path+": "+error);
+    }
+    fcntl(this->listen_fd, F_SETFL, O_NONBLOCK);
+}
+
+Daemon::~Daemon(){
+    close(this->listen_fd);
+    unlink(this->socket_path.c_str());
+}
+
+void Daemon::Stop(){
+    this->stop_requested = true;
+}
+
+GetSet& Daemon::World(const string& dir, const string& world_name){
+    string key = dir + "/" + world_name;
+    if(auto world = this->worlds.Find(key))
+        return *world;
+    auto connector = this->connectors.Find(dir);
+    if(connector == nullptr)
+        connector = &this->connectors.Insert(dir, dir.empty() ? DbConnector() : DbConnector(dir, 0));
+    //The compiled queries of an evicted world keep its connection until they are evicted in turn.
+    return this->worlds.Insert(key, connector->In(world_name));
+}
+
+void Daemon::Process(const string& request, string& output){
+    string response;
+    try{
+        if(request.empty())
+            throw runtime_error("Malformed request.");
+        uint8_t operation = request[0];
+        size_t offset = 1;
+        string dir          = ReadString(request, offset);
+        string world_name   = ReadString(request, offset);
+        string subject_name = ReadString(request, offset);
+        string basis_name   = ReadString(request, offset);
+        string csys_name    = ReadString(request, offset);
+        string key = dir + "/" + world_name + " " + subject_name + " " + basis_name + " " + csys_name;
+        if(operation == DAEMON_GET){
+            auto getter = this->getters.Find(key);
+            //The queries are compiled from the names directly, as the handles of the fluent interface would only be
+            // used once.
+            if(getter == nullptr){
+                auto& world = this->World(dir, world_name);
+                getter = &this->getters.Insert(key, CompiledGet(world.Connection(), world.world_name, subject_name, basis_name, csys_name));
+                //A blocked request must not freeze the other clients for the whole busy timeout.
+                getter->Within(this->timeout);
+            }
+            response.push_back(DAEMON_OK);
+            AppendPose(response, (*getter)());
+        }else if(operation == DAEMON_SET){
+            Eigen::Matrix4d pose = ReadPose(request, offset);
+            auto setter = this->setters.Find(key);
+            if(setter == nullptr){
+                auto& world = this->World(dir, world_name);
+                setter = &this->setters.Insert(key, CompiledSet(world.Connection(), world.world_name, subject_name, basis_name, csys_name, world.validation));
+                setter->Within(this->timeout);
+            }
+            setter->As(pose);
+            response.push_back(DAEMON_OK);
+        }else{
+            throw runtime_error("Unknown operation.");
+        }
+    }catch(const std::runtime_error& err){
+        response.clear();
+        response.push_back(DAEMON_ERROR);
+        response.append(err.what());
+    }
+    output.append(Frame(response));
+}
+
+bool Daemon::ProcessRequests(string& input, string& output){
+    size_t offset = 0;
+    uint32_t size;
+    bool valid = true;
+    while(input.size() - offset >= sizeof(size) && output.size() < DAEMON_MAX_OUTPUT){
+        memcpy(&size, input.data() + offset, sizeof(size));
+        //A client sending a request that cannot be valid is out of sync.
+        if(size > DAEMON_MAX_REQUEST){
+            valid = false;
+            break;
+        }
+        if(input.size() - offset - sizeof(size) < size)
+            break;
+        this->Process(input.substr(offset + sizeof(size), size), output);
+        offset += sizeof(size) + size;
+    }
+    input.erase(0, offset);
+    return valid;
+}
+
+void Daemon::Serve(){
+    //Data received from and to be sent to each client, indexed by file descriptor.
+    map<int, string> inputs;
+    map<int, string> outputs;
+    while(!this->stop_requested){
+        vector<pollfd> fds;
+        fds.push_back({this->listen_fd, POLLIN, 0});
+        //A client with too many responses queued is not read from until it reads them.
+        for(auto const& [fd, output] : outputs)
+            fds.push_back({fd, (short)((output.size() < DAEMON_MAX_OUTPUT ? POLLIN : 0) | (output.empty() ? 0 : POLLOUT)), 0});
+        //Wake up regularly to notice a stop request that arrived just before polling.
+        if(poll(fds.data(), fds.size(), 1000) < 0){
+            //Interrupted by a signal, possibly the one asking to stop.
+            if(errno == EINTR)
+                continue;
+            throw runtime_error("Cannot wait for requests: "+string(strerror(errno)));
+        }
+        //Accept new clients
+        if(fds[0].revents & POLLIN){
+            int client_fd;
+            while((client_fd = accept4(this->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+                inputs[client_fd] = "";
+                outputs[client_fd] = "";
+            }
+        }
+        for(size_t i = 1; i < fds.size(); i++){
+            int fd = fds[i].fd;
+            bool closed = fds[i].revents & (POLLERR | POLLNVAL);
+            string& input = inputs[fd];
+            string& output = outputs[fd];
+            //Read what is available and process the complete requests, in order. Reading stops once too many
+            // responses are queued, the following requests waiting in the socket, such that the input holds at
+            // most a request and the data read with it.
+            if(!closed && (fds[i].revents & (POLLIN | POLLHUP))){
+                char buffer[65536];
+                ssize_t n = 1;
+                while(!closed && output.size() < DAEMON_MAX_OUTPUT && (n = read(fd, buffer, sizeof(buffer))) > 0){
+                    input.append(buffer, n);
+                    closed = !this->ProcessRequests(input, output);
+                }
+                if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                    closed = true;
+            }
+            //Send as much of the responses as the socket accepts, then process the requests that were waiting for room.
+            if(!closed && !output.empty()){
+                ssize_t n = send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+                if(n > 0)
+                    output.erase(0, n);
+                else if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                    closed = true;
+                if(!closed)
+                    closed = !this->ProcessRequests(input, output);
+            }
+            if(closed){
+                close(fd);
+                inputs.erase(fd);
+                outputs.erase(fd);
+            }
+        }
+    }
+}
+
+DaemonClient::DaemonClient(string socket_path, string dir): dir(dir), pending(0){
+    sockaddr_un address = SocketAddress(socket_path);
+    this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(this->fd < 0)
+        throw runtime_error("Cannot create the socket: "+string(strerror(errno)));
+    if(connect(this->fd, (sockaddr*)&address, sizeof(address)) < 0){
+        close(this->fd);
+        throw runtime_error("No daemon is listening on "+socket_path+".");
+    }
+}
+
+DaemonClient::~DaemonClient(){
+    close(this->fd);
+}
+
+bool DaemonClient::IsRunning(string socket_path){
+    try{
+        DaemonClient client(socket_path);
+        return true;
+    }catch(const std::runtime_error& err){
+        return false;
+    }
+}
+
+void DaemonClient::Send(uint8_t operation, const string& world_name, const string& subject_name, const string& basis_name, const string& csys_name, const Eigen::Matrix4d* pose){
+    string request(1, operation);
+    AppendString(request, this->dir);
+    AppendString(request, world_name);
+    AppendString(request, subject_name);
+    AppendString(request, basis_name);
+    AppendString(request, csys_name);
+    if(pose != nullptr)
+        AppendPose(request, *pose);
+    string message = Frame(request);
+    size_t sent = 0;
+    while(sent < message.size()){
+        ssize_t n = send(this->fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            throw runtime_error("The connection to the daemon was lost.");
+        sent += n;
+    }
+    this->pending++;
+}
+
+void DaemonClient::SendGet(string world_name, string subject_name, string basis_name, string csys_name){
+    this->Send(DAEMON_GET, world_name, subject_name, basis_name, csys_name, nullptr);
+}
+
+void DaemonClient::SendSet(string world_name, string subject_name, string basis_name, string csys_name, Eigen::Matrix4d pose){
+    this->Send(DAEMON_SET, world_name, subject_name, basis_name, csys_name, &pose);
+}
+
+//Read exactly size bytes from the socket.
+void ReadFully(int fd, char* buffer, size_t size){
+    size_t received = 0;
+    while(received < size){
+        ssize_t n = read(fd, buffer + received, size - received);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            throw runtime_error("The connection to the daemon was lost.");
+        received += n;
+    }
+}
+
+Eigen::Matrix4d DaemonClient::Receive(){
+    if(this->pending == 0)
+        throw runtime_error("No request is waiting for a response.");
+    this->pending--;
+    uint32_t size;
+    ReadFully(this->fd, reinterpret_cast<char*>(&size), sizeof(size));
+    string response(size, '\0');
+    ReadFully(this->fd, response.data(), size);
+    if(response.empty())
+        throw runtime_error("Malformed response.");
+    if(response[0] != DAEMON_OK)
+        throw runtime_error(response.substr(1));
+    if(response.size() == 1)
+        return Eigen::Matrix4d::Identity();
+    return ReadPose(response, 1);
+}
+
+Eigen::Matrix4d DaemonClient::Get(string world_name, string subject_name, string basis_name, string csys_name){
+    this->SendGet(world_name, subject_name, basis_name, csys_name);
+    return this->Receive();
+}
+
+void DaemonClient::Set(string world_name, string subject_name, string basis_name, string csys_name, Eigen::Matrix4d pose){
+    this->SendSet(world_name, subject_name, basis_name, csys_name, pose);
+    this->Receive();
+}
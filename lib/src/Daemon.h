@@ -0,0 +1,243 @@
+#pragma once
+
+//Forward declaration
+class Daemon;
+class DaemonClient;
+
+#include "DbConnector.h"
+#include "GetSet.h"
+#include "ExpressedIn.h"
+#include <Eigen/Eigen>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+/*
+* Protocol spoken over the UNIX domain socket. All integers and reals are in the native (little-endian) byte order.
+*
+* Request:  u32 size of the rest of the message
+*           u8  operation (DAEMON_GET or DAEMON_SET)
+*           5 x (u16 length, bytes) for the directory, world, subject, basis and csys names
+*           16 x f64 pose in row-major order (DAEMON_SET only)
+*
+* Response: u32 size of the rest of the message
+*           u8  status (DAEMON_OK or DAEMON_ERROR)
+*           16 x f64 pose in row-major order (successful DAEMON_GET only) or the error message (DAEMON_ERROR only)
+*
+* Requests are answered in the order they are received such that a client can send many requests before reading the responses.
+*/
+const uint8_t DAEMON_GET   = 'G';
+const uint8_t DAEMON_SET   = 'S';
+const uint8_t DAEMON_OK    = 0;
+const uint8_t DAEMON_ERROR = 1;
+/// Size of the largest valid request: the operation, five strings of at most UINT16_MAX bytes and a pose.
+const uint32_t DAEMON_MAX_REQUEST = 1 + 5 * (sizeof(uint16_t) + UINT16_MAX) + 16 * sizeof(double);
+/// Size of the responses queued for a client above which its requests are no longer read until it reads the responses.
+const size_t DAEMON_MAX_OUTPUT = 1 << 20;
+
+/**
+ * @brief Map holding at most a fixed number of entries, evicting the least recently used one. For internal use only.
+ */
+template<typename Value>
+class LruMap
+{
+    private:
+        /// Maximum number of entries.
+        size_t capacity;
+        /// Entries from the most to the least recently used.
+        list<pair<string, Value>> entries;
+        /// Position of each entry in the list, indexed by key.
+        unordered_map<string, typename list<pair<string, Value>>::iterator> index;
+    public:
+        LruMap(size_t capacity): capacity(max(capacity, size_t(1))){}
+        /**
+         * @brief Get the value of a key and mark it as the most recently used.
+         *
+         * @return Value* The value, or nullptr if the key is not in the map.
+         */
+        Value* Find(const string& key){
+            auto entry = this->index.find(key);
+            if(entry == this->index.end())
+                return nullptr;
+            this->entries.splice(this->entries.begin(), this->entries, entry->second);
+            return &entry->second->second;
+        }
+        /**
+         * @brief Add a key that is not in the map, evicting the least recently used entry if the map is full.
+         *
+         * @return Value& The value stored in the map.
+         */
+        Value& Insert(const string& key, Value value){
+            if(this->entries.size() >= this->capacity){
+                this->index.erase(this->entries.back().first);
+                this->entries.pop_back();
+            }
+            this->entries.emplace_front(key, move(value));
+            this->index[key] = this->entries.begin();
+            return this->entries.front().second;
+        }
+        /// Number of entries.
+        size_t Size() const{ return this->entries.size(); }
+};
+
+/**
+ * @brief Long-running server answering Get/Set requests over a UNIX domain socket.
+ *
+ * The daemon keeps the worlds opened and the compiled queries cached in memory. Requests are processed one at a time,
+ * by the thread running Serve(), such that all writes are serialized in a single place.
+ *
+ * @note As a consequence, a request waiting for a lock held by another process delays the requests of every client,
+ *  readers included. Each request therefore waits for locks for a short time only, see the constructor, after which
+ *  it fails and its client receives a TimeoutError message, which it can retry.
+ *
+ * Example:
+ *
+ *     auto daemon = Daemon(Daemon::DefaultSocketPath());
+ *     daemon.Serve();
+ */
+class Daemon
+{
+    private:
+        /// Path to the UNIX domain socket.
+        string socket_path;
+        /// File descriptor of the listening socket.
+        int listen_fd;
+        /// Set to true to make Serve() return.
+        volatile bool stop_requested;
+        /// Time in milliseconds each request can wait for locks held by other processes.
+        int timeout;
+        /// Connectors indexed by the directory in which the databases are located, the empty string is the default directory.
+        LruMap<DbConnector> connectors;
+        /// Opened worlds indexed by directory and name, each with its connection.
+        LruMap<GetSet> worlds;
+        /// Compiled Get() queries indexed by directory, world and frame names, each keeping prepared statements.
+        LruMap<CompiledGet> getters;
+        /// Compiled Set() queries indexed by directory, world and frame names, each keeping prepared statements.
+        LruMap<CompiledSet> setters;
+        /**
+         * @brief Get the world located in the specified directory, opening it if needed.
+         */
+        GetSet& World(const string& dir, const string& world_name);
+        /**
+         * @brief Execute a single request and append the response to the output buffer.
+         *
+         * @param request: Content of the request, without the leading size.
+         * @param output: Buffer to which the response is appended.
+         */
+        void Process(const string& request, string& output);
+        /**
+         * @brief Execute the complete requests at the start of the input, in order, until too many responses are queued.
+         *
+         * @param input: Data received from a client, from which the executed requests are removed.
+         * @param output: Buffer to which the responses are appended, see DAEMON_MAX_OUTPUT.
+         * @return bool False if the input starts with a request larger than DAEMON_MAX_REQUEST, in which case the client must be disconnected.
+         */
+        bool ProcessRequests(string& input, string& output);
+    public:
+        /**
+         * @brief Create a daemon listening on the specified UNIX domain socket.
+         *
+         * @note The worlds and the compiled queries are cached up to the specified numbers, the least recently used
+         *  being closed first, such that a daemon receiving ever new frame names does not keep growing.
+         *
+         * @param socket_path: Path to the socket, see DefaultSocketPath().
+         * @param max_worlds: Maximum number of worlds kept opened, each with its own connection.
+         * @param max_queries: Maximum number of compiled Get() queries, and of compiled Set() queries, kept in memory.
+         * @param timeout: Time in milliseconds each request can wait for locks held by other processes, during which
+         *  the requests of the other clients wait too, see CompiledSet::Within().
+         *
+         * @throw runtime_error: If the socket cannot be created, for example if another daemon is already running.
+         */
+        Daemon(string socket_path, size_t max_worlds = 64, size_t max_queries = 4096, int timeout = 100);
+        Daemon(const Daemon&) = delete;
+        Daemon& operator=(const Daemon&) = delete;
+        ~Daemon();
+        /**
+         * @brief Answer requests until Stop() is called.
+         */
+        void Serve();
+        /**
+         * @brief Make Serve() return. Can be called from a signal handler.
+         */
+        void Stop();
+        /**
+         * @brief Path of the socket used when none is specified.
+         *
+         * @return The value of the WRT_SOCKET environment variable if set, $XDG_RUNTIME_DIR/wrt.sock if XDG_RUNTIME_DIR is set, /tmp/wrt-<uid>.sock otherwise.
+         */
+        static string DefaultSocketPath();
+};
+
+/**
+ * @brief Client performing Get/Set operations through a running Daemon instead of opening the databases itself.
+ *
+ * Example:
+ *
+ *     if(DaemonClient::IsRunning()){
+ *         auto client = DaemonClient();
+ *         Eigen::Matrix4d pose = client.Get("lab", "gripper", "camera", "camera");
+ *     }
+ */
+class DaemonClient
+{
+    private:
+        /// File descriptor of the connected socket.
+        int fd;
+        /// Directory in which the daemon looks for the databases, empty for the daemon's default.
+        string dir;
+        /// Number of requests sent but whose response was not read yet.
+        size_t pending;
+        /**
+         * @brief Send a request to the daemon without waiting for its response.
+         */
+        void Send(uint8_t operation, const string& world_name, const string& subject_name, const string& basis_name, const string& csys_name, const Eigen::Matrix4d* pose);
+    public:
+        /**
+         * @brief Connect to a running daemon.
+         *
+         * @param socket_path: Path to the socket of the daemon.
+         * @param dir: Directory in which the databases are located, empty to use the default directory of the daemon.
+         *
+         * @throw runtime_error: If no daemon is listening on the socket.
+         */
+        DaemonClient(string socket_path = Daemon::DefaultSocketPath(), string dir = "");
+        DaemonClient(const DaemonClient&) = delete;
+        DaemonClient& operator=(const DaemonClient&) = delete;
+        ~DaemonClient();
+        /**
+         * @brief Check if a daemon is listening on the specified socket.
+         */
+        static bool IsRunning(string socket_path = Daemon::DefaultSocketPath());
+        /**
+         * @brief Get the pose of the subject frame with respect to the basis frame and expressed in the csys frame.
+         *
+         * @throw runtime_error: If the daemon reported an error or if the connection was lost.
+         */
+        Eigen::Matrix4d Get(string world_name, string subject_name, string basis_name, string csys_name);
+        /**
+         * @brief Set the pose of the subject frame with respect to the basis frame and expressed in the csys frame.
+         *
+         * @throw runtime_error: If the daemon reported an error or if the connection was lost.
+         */
+        void Set(string world_name, string subject_name, string basis_name, string csys_name, Eigen::Matrix4d pose);
+        /**
+         * @brief Queue a Get request without waiting for its response, which must then be read with Receive().
+         */
+        void SendGet(string world_name, string subject_name, string basis_name, string csys_name);
+        /**
+         * @brief Queue a Set request without waiting for its response, which must then be read with Receive().
+         */
+        void SendSet(string world_name, string subject_name, string basis_name, string csys_name, Eigen::Matrix4d pose);
+        /**
+         * @brief Read the response to the oldest queued request.
+         *
+         * @throw runtime_error: If the daemon reported an error, if the connection was lost or if no request is pending.
+         *
+         * @return Eigen::Matrix4d The pose for a Get request, the identity for a Set request.
+         */
+        Eigen::Matrix4d Receive();
+};
@@ -1,19 +1,29 @@
 #include "DbConnector.h"
-#include <regex>
+#include "Busy.h"
+#include "Trace.h"
+#include "NameTable.h"
+#include "Pose.h"
 #include <filesystem>
 #include <iostream>
-#include <fstream>
 #include <unistd.h>
 #include <pwd.h>
 using namespace std;
 
-DbConnector::DbConnector(string db_dir_override, uint8_t flags): db_dir_override(db_dir_override){
+DbConnector::DbConnector(string db_dir_override, uint8_t flags, ConnectionOptions options): db_dir_override(db_dir_override), options(options){
+    this->options.Validate();
     //Each bit set to 1 corresponds to a flag being raised.
     //TEMPORARY_DATABASE: Delete database file when DbConnector is destroyed
     this->temporary_db = flags & this->TEMPORARY_DATABASE; 
+    //RECORD_HISTORY: Create the history table in the worlds opened by this connector
+    this->record_history = flags & this->RECORD_HISTORY;
+    //COLLECT_STATS: Count the operations performed on the worlds opened by this connector
+    this->collect_stats = flags & this->COLLECT_STATS;
+    //SINGLE_PRECISION: Store the poses as packed floats in the worlds created by this connector
+    this->single_precision = flags & this->SINGLE_PRECISION;
 }
 
 //Delegated constructors
+DbConnector::DbConnector(string db_dir_override, uint8_t flags): DbConnector(db_dir_override, flags, ConnectionOptions()){}
 DbConnector::DbConnector(uint8_t flags): DbConnector("", flags){}
 DbConnector::DbConnector(): DbConnector("", 0){}
 
@@ -84,29 +94,33 @@ bool DbConnector::IsDirectoryWritable(string path){
 */
 bool DbConnector::IsDirectoryWritable(std::filesystem::path path){
     if(std::filesystem::is_directory(path)){
-        if(!std::filesystem::exists(path)){
-            return false;
-        }else{
-            //The path is a directory and it exists, so test if it is writable.
-            ofstream test_file(path.string()+"/test_if_directory_writable.txt");
-            if(test_file.is_open()){
-                test_file.close();
-                std::filesystem::remove(path.string()+"/test_if_directory_writable.txt");
-                return true;
-            }else{
-                return false;
-            }
-        }
+        //The path is a directory and it exists, so ask the kernel whether it is writable, without creating any file.
+        return access(path.c_str(), W_OK) == 0;
     }else{
         //If the path is not a directory, check if the parent directory is writable
+        if(!path.has_parent_path() || path.parent_path() == path)
+            return false;
         return IsDirectoryWritable(path.parent_path());
     }
 }
 
-GetSet DbConnector::In(string world_name){
-    if(!regex_match(world_name, regex(R"(^[0-9a-z\-]+$)")))
-        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the world name.");
-    
+shared_ptr<SQLite::Database> DbConnector::Connect(string world_path, int timeout){
+    ConnectionOptions options;
+    options.busy_timeout = timeout;
+    return Connect(world_path, options);
+}
+
+shared_ptr<SQLite::Database> DbConnector::Connect(string world_path, const ConnectionOptions& options){
+    auto stats = StatsCollector::Find(world_path);
+    auto db = make_shared<WorldConnection>(world_path+".db", options, stats);
+    if(stats)
+        stats->db_opens++;
+    WRT_TRACE(db_open, world_path.c_str(), "", 0);
+    db->exec(options.Pragmas());
+    return db;
+}
+
+string DbConnector::ResolveDirectory(){
     /*
     The following rules are used to determine the directory in which the database is stored:
     1. If the db_dir_override is set, use that directory. Throw an exception if the directory is not writable.
@@ -115,7 +129,6 @@ GetSet DbConnector::In(string world_name){
     4. If this->temporary_db == False, and the executable is located in a directory that is NOT writable, use the home directory.
     */
 
-    auto DB_EXISTS = false;
     //Get the path to the directory of the executable
     std::filesystem::path exe_dir = get_exe_dir_abs_path();
 
@@ -141,25 +154,37 @@ GetSet DbConnector::In(string world_name){
     if(!IsDirectoryWritable(exe_dir)){
         throw filesystem::filesystem_error("The directory is not writable.", exe_dir, std::error_code());
     }
+    return string(std::filesystem::absolute(exe_dir));
+}
 
-    //Get a list of existing databases in directory
-    //to see if database already exists.
-    for (auto const& entry : filesystem::directory_iterator{exe_dir}){
-        std::filesystem::path entry_path = entry.path();
-        if(entry.is_regular_file() && entry_path.extension() == ".db"){
-            auto fn = entry_path.filename();
-            if(fn == world_name+".db")
-                DB_EXISTS = true;
-        }
-    }
+bool DbConnector::IsSinglePrecision(SQLite::Database& db){
+    //Worlds created with SINGLE_PRECISION have a single pose column instead of R00, ..., t2.
+    SQLite::Statement query(db, "SELECT 1 FROM pragma_table_info('frames') WHERE name = 'pose'");
+    return query.executeStep();
+}
+
+GetSet DbConnector::In(string world_name){
+    if(!VerifyInput(world_name))
+        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the world name.");
 
-    world_name = string(std::filesystem::absolute(exe_dir)) + "/" + world_name;
-    this->db_path = world_name+".db";
+    //The directory is resolved once for the lifetime of the connector.
+    if(this->db_dir.empty())
+        this->db_dir = this->ResolveDirectory();
+    string world_path = this->db_dir + "/" + world_name;
+    this->db_path = world_path+".db";
+    if(this->collect_stats)
+        StatsCollector::Register(world_path);
+    //A world already opened by this connector exists and is initialized.
+    if(this->opened_worlds.count(world_name) > 0)
+        return GetSet(world_path, this->options);
 
-    if(DB_EXISTS == false){
-        //Initialize the database.
-        //Connects to the database and create it if it doesnt already exist.
-        SQLite::Database db(this->db_path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    //Opening with OPEN_CREATE costs the same in any directory, unlike listing the directory to find the database.
+    SQLite::Database db(this->db_path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, this->options.busy_timeout);
+    WRT_TRACE(db_open, world_path.c_str(), "", 0);
+    if(!db.tableExists("frames")){
+        //Initialize the database. Every statement is idempotent in case another process does the same concurrently.
+        //The page size can only be changed before the first table is created.
+        db.exec("PRAGMA page_size = "+to_string(this->options.page_size)+";");
         db.exec("PRAGMA journal_mode=WAL;");
         db.exec("PRAGMA synchronous = off;");
         /*
@@ -173,8 +198,48 @@ GetSet DbConnector::In(string world_name){
         The 'world' frame is always the inertial/immobile reference frame, it's parent is set to NULL/None.
         All other frames must have a non-NULL parent, creating a tree with a single root.
         */
-        db.exec("CREATE TABLE IF NOT EXISTS frames( \
-                        name TEXT PRIMARY KEY, \
+        if(this->single_precision){
+            //The same pose as a blob of 12 floats (R00, ..., R22, t0, t1, t2), see PackPose().
+            db.exec("CREATE TABLE IF NOT EXISTS frames( \
+                            name TEXT PRIMARY KEY, \
+                            parent TEXT, \
+                            pose BLOB \
+                        );");
+            SQLite::Statement world_frame(db, "INSERT OR IGNORE INTO frames VALUES ('world', NULL, ?)");
+            auto identity = PackPose(SE3::Identity());
+            world_frame.bind(1, identity.data(), PACKED_POSE_SIZE);
+            world_frame.exec();
+        }else{
+            db.exec("CREATE TABLE IF NOT EXISTS frames( \
+                            name TEXT PRIMARY KEY, \
+                            parent TEXT, \
+                            R00 REAL, \
+                            R01 REAL, \
+                            R02 REAL, \
+                            R10 REAL, \
+                            R11 REAL, \
+                            R12 REAL, \
+                            R20 REAL, \
+                            R21 REAL, \
+                            R22 REAL, \
+                            t0 REAL, \
+                            t1 REAL, \
+                            t2 REAL \
+                        );");
+            db.exec("INSERT OR IGNORE INTO frames VALUES ('world', NULL, 1,0,0, 0,1,0, 0,0,1, 0,0,0)");
+        }
+    }
+    //Finding the children of a frame is needed to check for kinematic loops when setting a pose.
+    db.exec("CREATE INDEX IF NOT EXISTS frames_parent ON frames(parent);");
+    if(this->record_history){
+        /*
+        Each row describes the pose of a frame, relative to its parent at that time, from the specified time on.
+        The time is in seconds since the epoch and the primary key (name, time) makes finding the samples
+        surrounding any time a logarithmic search. A WITHOUT ROWID table stores the rows in this very index.
+        */
+        db.exec("CREATE TABLE IF NOT EXISTS history( \
+                        name TEXT, \
+                        time REAL, \
                         parent TEXT, \
                         R00 REAL, \
                         R01 REAL, \
@@ -187,9 +252,10 @@ GetSet DbConnector::In(string world_name){
                         R22 REAL, \
                         t0 REAL, \
                         t1 REAL, \
-                        t2 REAL \
-                    );");
-        db.exec("INSERT INTO frames VALUES ('world', NULL, 1,0,0, 0,1,0, 0,0,1, 0,0,0)");
+                        t2 REAL, \
+                        PRIMARY KEY (name, time) \
+                    ) WITHOUT ROWID;");
     }
-    return GetSet(world_name);
+    this->opened_worlds.insert(world_name);
+    return GetSet(world_path, this->options);
 }
\ No newline at end of file
@@ -6,6 +6,10 @@ class DbConnector;
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <set>
+#include "ConnectionOptions.h"
+#include "Stats.h"
 #include "GetSet.h"
 using namespace std;
 
@@ -28,6 +32,11 @@ using namespace std;
  * 
  *    auto wrt = DbConnector("/tmp", DbConnector::TEMPORARY_DATABASE);
  *    auto world = wrt.In("deed")
+ * 
+ * Example 4: Connecting to the *kitchen* world with connections tuned for reading, see ConnectionOptions.
+ * 
+ *    auto wrt = DbConnector("", 0, ConnectionOptions::ReadOptimized());
+ *    auto world = wrt.In("kitchen")
  */
 class DbConnector
 {
@@ -36,8 +45,28 @@ class DbConnector
         string db_dir_override;
         /// Whether the database is temporary or not.
         bool temporary_db;
+        /// Whether the worlds opened by this connector record the history of the poses.
+        bool record_history;
+        /// Whether the statistics of the worlds opened by this connector are collected.
+        bool collect_stats;
+        /// Whether the worlds created by this connector store their poses in single precision.
+        bool single_precision;
+        /// Settings applied to the connections opened to the worlds.
+        ConnectionOptions options;
         /// Path to the database.
         string db_path;
+        /// Absolute path to the directory in which the databases are stored, resolved by the first call to In().
+        string db_dir;
+        /// Names of the worlds already opened by this connector, which are known to exist.
+        set<string> opened_worlds;
+        /**
+         * @brief Find the directory in which the databases are stored, according to the rules described in In().
+         * 
+         * @throws filesystem::filesystem_error if the directory is not writable.
+         * 
+         * @return string Absolute path to the directory.
+         */
+        string ResolveDirectory();
         /**
          * @brief Check if the directory at the specified path is writable.
          * 
@@ -59,6 +88,9 @@ class DbConnector
          * @param flags: Options to use when creating the database (by default, no flag is set). 
          * 
          * @see DbConnector::TEMPORARY_DATABASE
+         * @see DbConnector::RECORD_HISTORY
+         * @see DbConnector::COLLECT_STATS
+         * @see DbConnector::SINGLE_PRECISION
          */
         DbConnector(uint8_t flags);
         /**
@@ -68,8 +100,21 @@ class DbConnector
          * @param flags: Options to use when creating the database (by default, no flag is set).
          * 
          * @see DbConnector::TEMPORARY_DATABASE
+         * @see DbConnector::RECORD_HISTORY
+         * @see DbConnector::COLLECT_STATS
+         * @see DbConnector::SINGLE_PRECISION
          */
         DbConnector(string path, uint8_t flags);
+        /**
+         * @brief Construct a new DbConnector object using the user-specified directory, flags and connection settings.
+         * 
+         * @param path: Path to the directory where the database is stored, or an empty string for the default directory.
+         * @param flags: Options to use when creating the database (by default, no flag is set).
+         * @param options: Settings applied once to every connection opened to the worlds.
+         * 
+         * @throw runtime_error: If a setting has an invalid value.
+         */
+        DbConnector(string path, uint8_t flags, ConnectionOptions options);
         ~DbConnector();
         /**
          * @brief Set up a connection to the database to the specified *world*.
@@ -81,6 +126,54 @@ class DbConnector
          * @throws filesystem::filesystem_error if the database directory is not writable.
          */
         GetSet In(string world);
+        /**
+         * @brief Open a connection to the database of a world, configured for concurrent accesses.
+         * 
+         * @param world_path: Path to the database of the world, without the .db extension.
+         * @param timeout: Time in milliseconds to wait for a lock held by another connection before failing.
+         * 
+         * @return shared_ptr<SQLite::Database> Connection that can be shared by many queries.
+         */
+        static shared_ptr<SQLite::Database> Connect(string world_path, int timeout);
+        /**
+         * @brief Open a connection to the database of a world, configured with the specified settings.
+         * 
+         * @param world_path: Path to the database of the world, without the .db extension.
+         * @param options: Settings applied to the connection.
+         * 
+         * @return shared_ptr<SQLite::Database> Connection that can be shared by many queries.
+         */
+        static shared_ptr<SQLite::Database> Connect(string world_path, const ConnectionOptions& options);
+        /**
+         * @brief Check whether a world stores the poses of its frames in single precision, see DbConnector::SINGLE_PRECISION.
+         * 
+         * @param db: Connection to the database of the world.
+         */
+        static bool IsSinglePrecision(SQLite::Database& db);
         /// Flag specifying that the database should be deleted when the DbConnector object is destroyed.
         static const uint8_t TEMPORARY_DATABASE = 0b00000001;
+        /**
+         * @brief Flag specifying that every pose written in the worlds opened by this connector is also kept in a history table,
+         *  which allows querying past poses with ExpressedInGet::At().
+         * 
+         * @note Once a world records its history, it does so for all the connections to it, with or without this flag.
+         */
+        static const uint8_t RECORD_HISTORY = 0b00000010;
+        /**
+         * @brief Flag specifying that this process counts the operations performed on the worlds opened by this connector
+         *  and measures their latency, which are returned by GetSet::Stats().
+         * 
+         * @note The statistics of a world are collected for the whole process once it is opened with this flag, by all
+         *  the connections to it. Without this flag, the operations only check whether the statistics are collected.
+         */
+        static const uint8_t COLLECT_STATS = 0b00000100;
+        /**
+         * @brief Flag specifying that the worlds created by this connector store the pose of each frame as 12 packed floats
+         *  instead of 12 double precision columns, which halves the size of the frames table and of its pages in memory.
+         * 
+         * @note The precision is chosen when the world is created and kept by all the connections to it, with or without this
+         *  flag. The poses are still set and returned in double precision, and computed in double precision. The history
+         *  of the poses, if recorded, is kept in double precision.
+         */
+        static const uint8_t SINGLE_PRECISION = 0b00001000;
 };
\ No newline at end of file
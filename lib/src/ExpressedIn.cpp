@@ -1,24 +1,98 @@
 
 #include "ExpressedIn.h"
-#include <regex>
+#include <sqlite3.h>
 #include <cfloat>
+#include <cmath>
 #include <iostream>
 #include <tuple>
+#include <chrono>
+#include <set>
 using namespace std;
 
-bool VerifyInput(string name){
-    return regex_match(name, regex(R"(^[0-9a-z\-]+$)"));
+double CurrentTime(){
+    return chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
 }
 
-int VerifyMatrix(Eigen::Affine3d transfo_matrix){
-    //1) Verify that the rotation matrix is nearly orthogonal (transpose(R) == inverse(R))
-    Eigen::Matrix3d rot = transfo_matrix.rotation();
-    Eigen::Matrix3d result = rot * rot.transpose() - Eigen::Matrix3d::Identity();
-    auto tolerance = 100 * DBL_EPSILON;
-    if(result.norm() > tolerance)
+//Prepare a statement, counting it in the statistics of the world if they are collected.
+shared_ptr<SQLite::Statement> Prepare(SQLite::Database& db, const char* sql, StatsCollector* stats){
+    if(stats)
+        stats->statements_prepared++;
+    auto statement = make_shared<SQLite::Statement>(db, sql);
+    WRT_TRACE(prepare, db.getFilename().c_str(), sql, 0);
+    return statement;
+}
+
+//Execute a step of a statement. The event is emitted once done, such that waiting for a lock shows up as a long step.
+// Failing to get a lock in time is reported as a TimeoutError.
+bool Step(SQLite::Statement& query){
+    bool row;
+    try{
+        row = query.executeStep();
+    }catch(const SQLite::Exception& err){
+        RethrowBusy(err, sqlite3_db_filename(sqlite3_db_handle(query.getPreparedStatement()), "main"));
+    }
+    WRT_TRACE(step, sqlite3_db_filename(sqlite3_db_handle(query.getPreparedStatement()), "main"), query.getQuery().c_str(), row);
+    return row;
+}
+
+//Execute a statement that returns no row, such as a transaction control statement, reporting a lock not obtained in time as a TimeoutError.
+void Exec(SQLite::Database& db, const char* sql){
+    try{
+        db.exec(sql);
+    }catch(const SQLite::Exception& err){
+        RethrowBusy(err, db.getFilename());
+    }
+}
+
+//Emit the enter event of a Get or Set when constructed and its exit event when destroyed, which fails if an exception is propagating.
+class OperationTrace{
+    private:
+        const string& world_name;
+        const string& subject_name;
+        bool is_get;
+        int exceptions;
+    public:
+        OperationTrace(const string& world_name, const string& subject_name, bool is_get):
+            world_name(world_name), subject_name(subject_name), is_get(is_get), exceptions(0){
+#ifdef WRT_TRACING
+            this->exceptions = uncaught_exceptions();
+            if(this->is_get)
+                WRT_TRACE(get_enter, this->world_name.c_str(), this->subject_name.c_str(), 0);
+            else
+                WRT_TRACE(set_enter, this->world_name.c_str(), this->subject_name.c_str(), 0);
+#endif
+        }
+        ~OperationTrace(){
+#ifdef WRT_TRACING
+            bool failed = uncaught_exceptions() > this->exceptions;
+            if(this->is_get)
+                WRT_TRACE(get_exit, this->world_name.c_str(), this->subject_name.c_str(), failed);
+            else
+                WRT_TRACE(set_exit, this->world_name.c_str(), this->subject_name.c_str(), failed);
+#endif
+        }
+};
+
+//Largest deviation from a rotation matrix of the rotations computed in double precision, stored as they are.
+const double DOUBLE_PRECISION_TOLERANCE = 100 * DBL_EPSILON;
+//Same for the rotations computed in single precision, see CompiledSet::As(const Eigen::Isometry3f&).
+const double SINGLE_PRECISION_TOLERANCE = 100 * FLT_EPSILON;
+//Largest deviation from a rotation matrix accepted by PoseValidation::Tolerant.
+const double DRIFT_TOLERANCE = 1e-4;
+
+//Frobenius norm of R*R^T - I, zero for a rotation matrix.
+double OrthogonalityError(const Eigen::Matrix3d& rot){
+    return (rot * rot.transpose() - Eigen::Matrix3d::Identity()).norm();
+}
+
+int VerifyMatrix(const Eigen::Affine3d& transfo_matrix, double tolerance){
+    //The upper left block itself is checked, as the rotation of its polar decomposition would always pass.
+    //1) Verify that the rotation matrix is nearly orthogonal (transpose(R) == inverse(R)), rejecting NaNs
+    Eigen::Matrix3d rot = transfo_matrix.linear();
+    if(!(OrthogonalityError(rot) <= tolerance))
         return -1;
-    //2) Verify that the determinant of the rotation matrix is 1
-    if(abs(rot.determinant() - 1) > tolerance)
+    //2) Verify that the determinant of the rotation matrix is 1, which excludes reflections
+    if(!(abs(rot.determinant() - 1) <= tolerance))
         return -2;
     //3) Verify that the last row is [0,0,0,1]
     if( transfo_matrix(3,0) != 0 || transfo_matrix(3,1) != 0 || transfo_matrix(3,2) != 0 || transfo_matrix(3,3) != 1 )
@@ -32,7 +106,7 @@ RefFrame::RefFrame(string subject_name, string parent_name, Eigen::Affine3d tran
     parent_name(parent_name),
     rotation(transfo.rotation()),
     translation(transfo.translation()){
-        int code = VerifyMatrix(transfo);
+        int code = VerifyMatrix(transfo, DOUBLE_PRECISION_TOLERANCE);
         if(code < 0)
             throw runtime_error("The format of the submitted matrix is wrong ("+to_string(code)+").");
         //Normalize the quaternion
@@ -51,56 +125,313 @@ RefFrame::RefFrame(string subject_name, string parent_name, Eigen::Quaterniond q
 
 RefFrame::~RefFrame(){}
 
-SetAs::SetAs(string world_name, string subject_name, string basis_name, string csys_name):
+SetAs::SetAs(string_view world_name, string_view subject_name, string_view basis_name, string_view csys_name, shared_ptr<SQLite::Database> db):
+    SetAs(NameTable::Worlds().Intern(world_name), 
+        NameTable::Frames().Intern(subject_name), 
+        NameTable::Frames().Intern(basis_name), 
+        NameTable::Frames().Intern(csys_name), 
+        db,
+        PoseValidation::Strict){}
+
+SetAs::SetAs(NameId world, NameId subject, NameId basis, NameId csys, shared_ptr<SQLite::Database> db, PoseValidation validation):
+    world(world), 
+    subject(subject), 
+    basis(basis),
+    csys(csys),
+    db(db),
+    validation(validation){
+    //Only the busy timeout of the connection applies unless Within() is called.
+    this->timeout = 0;
+}
+
+SetAs::~SetAs(){}
+
+void SetAs::As(Eigen::Matrix4d transformation_matrix){
+    this->Compile().As(transformation_matrix);
+}
+
+void SetAs::As(Eigen::Matrix4d transformation_matrix, double time){
+    this->Compile().As(transformation_matrix, time);
+}
+
+void SetAs::As(const Eigen::Isometry3d& pose){
+    this->Compile().As(pose);
+}
+
+void SetAs::As(const Eigen::Isometry3d& pose, double time){
+    this->Compile().As(pose, time);
+}
+
+void SetAs::As(const Eigen::Isometry3f& pose){
+    this->Compile().As(pose);
+}
+
+void SetAs::As(const Eigen::Isometry3f& pose, double time){
+    this->Compile().As(pose, time);
+}
+
+void SetAs::As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation){
+    this->Compile().As(rotation, translation);
+}
+
+void SetAs::As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation, double time){
+    this->Compile().As(rotation, translation, time);
+}
+
+void SetAs::As(const PoseArray& pose){
+    this->Compile().As(pose);
+}
+
+void SetAs::As(const PoseArray& pose, double time){
+    this->Compile().As(pose, time);
+}
+
+CompiledSet SetAs::Compile(){
+    auto& world_name = NameTable::Worlds().Name(this->world);
+    auto db = this->db ? this->db : DbConnector::Connect(world_name, ConnectionOptions());
+    auto& frames = NameTable::Frames();
+    CompiledSet compiled(db, world_name, frames.Name(this->subject), frames.Name(this->basis), frames.Name(this->csys), this->validation);
+    compiled.Within(this->timeout);
+    return compiled;
+}
+
+SetAs SetAs::Within(int timeout){
+    SetAs query = *this;
+    query.timeout = timeout;
+    return query;
+}
+
+CompiledSet::CompiledSet(string world_name, string subject_name, string basis_name, string csys_name):
+    CompiledSet(DbConnector::Connect(world_name, ConnectionOptions()), world_name, subject_name, basis_name, csys_name){}
+
+CompiledSet::CompiledSet(shared_ptr<SQLite::Database> db, string world_name, string subject_name, string basis_name, string csys_name, PoseValidation validation):
     world_name(world_name), 
     subject_name(subject_name), 
     basis_name(basis_name),
-    csys_name(csys_name){
+    csys_name(csys_name),
+    db(db),
+    validation(validation){
     if(!VerifyInput(subject_name) || !VerifyInput(basis_name) || !VerifyInput(csys_name))
         throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
-    //Set the timeout to 10 seconds
-    this->timeout = 10000;
+    //Same checks as GetSet::Set() and WrtSet::Wrt(), for the queries compiled without them.
+    if(subject_name == "world")
+        throw runtime_error("Cannot change the 'world' reference frame as it's assumed to be an inertial/immobile frame.");
+    if(subject_name == basis_name)
+        throw runtime_error("The reference frame "+basis_name+" must be different than the target frame "+subject_name+".");
+    //Only the busy timeout of the connection applies unless Within() is called.
+    this->timeout = 0;
+    this->stats = StatsCollector::Find(world_name);
+    auto stats = this->stats.get();
+    this->exists_query = Prepare(*this->db, "SELECT name, parent FROM frames WHERE name IN (?, ?, ?)", stats);
+    this->parent_query = Prepare(*this->db, "SELECT parent FROM frames WHERE name = ?", stats);
+    //A single search in the frames_parent index, see DbConnector::In().
+    this->children_query = Prepare(*this->db, "SELECT 1 FROM frames WHERE parent = ? LIMIT 1", stats);
+    //Replacing removes any previous definition of the frame before storing the new one.
+    this->single_precision = DbConnector::IsSinglePrecision(*this->db);
+    if(this->single_precision)
+        this->insert_query = Prepare(*this->db, "INSERT OR REPLACE INTO frames VALUES (?, ?, ?)", stats);
+    else
+        this->insert_query = Prepare(*this->db, "INSERT OR REPLACE INTO frames VALUES (?, ?, ?,?,?, ?,?,?, ?,?,?, ?,?,?)", stats);
+    //The world records its history if the table was created, see DbConnector::RECORD_HISTORY.
+    auto history_exists = Prepare(*this->db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'history'", stats);
+    if(Step(*history_exists))
+        this->history_query = Prepare(*this->db, "INSERT OR REPLACE INTO history VALUES (?, ?, ?, ?,?,?, ?,?,?, ?,?,?, ?,?,?)", stats);
 }
 
-SetAs::~SetAs(){}
+CompiledSet::~CompiledSet(){}
+
+CompiledSet& CompiledSet::Within(int timeout){
+    this->timeout = timeout;
+    return *this;
+}
 
 /*
-*    Check if a frame exists in the database
-*
-*    @param db: The database to check
-*    @param subject_name: The name of the frame to check
+*    Check which of the frames involved in the query exist in the database, using a single query.
 *
-*    @return: True if the frame exists, false otherwise
+*    @param subject_exists: Set to true if the subject frame exists, false otherwise
+*    @param basis_exists: Set to true if the basis frame exists, false otherwise
+*    @param csys_exists: Set to true if the csys frame exists, false otherwise
+*    @param subject_parent: Set to the current parent of the subject frame, if it exists
 */
-bool SetAs::FrameExistsInDB(SQLite::Database& db, string subject_name){
-    SQLite::Statement   query(db, "SELECT * FROM frames WHERE name IS ?");
-    query.bind(1, subject_name);
+void CompiledSet::FramesExistInDB(bool& subject_exists, bool& basis_exists, bool& csys_exists, string& subject_parent){
+    SQLite::Statement& query = *this->exists_query;
+    query.reset();
+    query.bind(1, this->subject_name);
+    query.bind(2, this->basis_name);
+    query.bind(3, this->csys_name);
 
-    //Verify that the frame exists.
-    int row_counter = 0;
-    while (query.executeStep()){
-        row_counter++;
+    subject_exists = basis_exists = csys_exists = false;
+    while (Step(query)){
+        if(this->stats)
+            this->stats->rows_read++;
+        const char* name = query.getColumn(0).getText();
+        if(this->subject_name == name){
+            subject_exists = true;
+            subject_parent = query.getColumn(1).getText();
+        }
+        basis_exists   |= this->basis_name == name;
+        csys_exists    |= this->csys_name == name;
     }
-    if(row_counter == 0)
-        return false;
-    if(row_counter != 1)
-        throw runtime_error("Need a single reference frame "+subject_name+".");
-    return true;
+}
+
+/*
+*    A frame without children cannot be an ancestor of its new parent. Otherwise, walk up the tree from the basis frame,
+*    which only has to stop at the root or at the subject frame. Any loop already in the database is detected with
+*    Brent's algorithm, see CompiledGet::PoseWrtRootCurrent().
+*/
+void CompiledSet::CheckForLoop(){
+    SQLite::Statement& children = *this->children_query;
+    children.reset();
+    children.bind(1, this->subject_name);
+    bool has_children = Step(children);
+    children.reset();
+    if(this->stats && has_children)
+        this->stats->rows_read++;
+    if(!has_children)
+        return;
+    SQLite::Statement& query = *this->parent_query;
+    string name = this->basis_name;
+    string tortoise = name;
+    size_t power = 1, steps = 0;
+    while(name != this->subject_name){
+        query.reset();
+        query.bind(1, name);
+        bool found = Step(query);
+        string parent_name = found ? query.getColumn(0).getText() : "";
+        query.reset();
+        if(this->stats && found)
+            this->stats->rows_read++;
+        //The root of the tree has no parent, or an undefined one.
+        if(parent_name.empty())
+            return;
+        name = parent_name;
+        if(name == tortoise)
+            throw runtime_error("The frame "+this->basis_name+" is part of a kinematic loop.");
+        if(++steps == power){
+            tortoise = name;
+            power *= 2;
+            steps = 0;
+        }
+    }
+    throw runtime_error("The frame "+this->subject_name+" cannot be defined with respect to "+this->basis_name+" as it would create a kinematic loop.");
 }
 
 //Write to the database the transformation matrix defining the frame subject_name with respect to the frame basis_name
 // and expressed in the frame basis_name, that is X_S_B.
-void SetAs::As(Eigen::Matrix4d transformation_matrix){
+void CompiledSet::As(Eigen::Matrix4d transformation_matrix){
+    this->As(transformation_matrix, CurrentTime());
+}
+
+void CompiledSet::As(Eigen::Matrix4d transformation_matrix, double time){
     Eigen::Affine3d transfo_matrix;
     transfo_matrix.matrix() = transformation_matrix;
-    int code = VerifyMatrix(transfo_matrix);
-    if(code < 0)
-        throw runtime_error("The format of the submitted matrix is wrong ("+to_string(code)+").");
-    //List all existing reference names
-    SQLite::Database db(this->world_name+".db", SQLite::OPEN_READWRITE, this->timeout);
-    db.exec("PRAGMA journal_mode=WAL;");
-    db.exec("PRAGMA synchronous = off;");
+    this->Store(transfo_matrix, time, DOUBLE_PRECISION_TOLERANCE);
+}
+
+void CompiledSet::As(const Eigen::Isometry3d& pose){
+    this->As(pose, CurrentTime());
+}
+
+void CompiledSet::As(const Eigen::Isometry3d& pose, double time){
+    //The type of the transformation does not guarantee that its linear part is a rotation, it is verified as a matrix.
+    this->Store(Eigen::Affine3d(pose.matrix()), time, DOUBLE_PRECISION_TOLERANCE);
+}
+
+void CompiledSet::As(const Eigen::Isometry3f& pose){
+    this->As(pose, CurrentTime());
+}
+
+void CompiledSet::As(const Eigen::Isometry3f& pose, double time){
+    //The rotation is checked to the precision of a float and orthonormalized in double precision, such that the error
+    // of the single precision input is not stored.
+    this->Store(Eigen::Affine3d(pose.matrix().cast<double>()), time, SINGLE_PRECISION_TOLERANCE);
+}
+
+void CompiledSet::As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation){
+    this->As(rotation, translation, CurrentTime());
+}
 
+void CompiledSet::As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation, double time){
+    double norm = rotation.norm();
+    if(!isfinite(norm) || norm < DBL_EPSILON)
+        throw runtime_error("The quaternion must be finite and different from zero.");
+    if(!translation.allFinite())
+        throw runtime_error("The translation must be finite.");
+    //A unit quaternion always gives a rotation matrix, such that the pose is stored without being verified.
+    Eigen::Affine3d transfo_matrix = Eigen::Affine3d::Identity();
+    transfo_matrix.linear() = Eigen::Quaterniond(rotation.coeffs() / norm).toRotationMatrix();
+    transfo_matrix.translation() = translation;
+    this->Store(transfo_matrix, time, 0);
+}
+
+void CompiledSet::As(const PoseArray& pose){
+    this->As(pose, CurrentTime());
+}
+
+void CompiledSet::As(const PoseArray& pose, double time){
+    //Eigen stores the coefficients of a quaternion as x, y, z, w, the order of the array.
+    this->As(Eigen::Quaterniond(pose.data() + 3), Eigen::Vector3d(pose.data()), time);
+}
+
+void CompiledSet::Store(Eigen::Affine3d transfo_matrix, double time, double precision){
+    OperationTrace trace(this->world_name, this->subject_name, false);
+    OperationTimer timer(this->stats.get(), false);
+    CallDeadline deadline(this->timeout);
+    if(precision > 0 && this->validation != PoseValidation::Trusted){
+        double tolerance = this->validation == PoseValidation::Tolerant ? max(precision, DRIFT_TOLERANCE) : precision;
+        int code = VerifyMatrix(transfo_matrix, tolerance);
+        if(code < 0)
+            throw runtime_error("The format of the submitted matrix is wrong ("+to_string(code)+").");
+        //A rotation off by more than the rounding errors of double precision is replaced by the nearest rotation matrix,
+        // that of its polar decomposition, such that the error does not accumulate in the poses computed from it.
+        if(tolerance > DOUBLE_PRECISION_TOLERANCE && OrthogonalityError(transfo_matrix.linear()) > DOUBLE_PRECISION_TOLERANCE)
+            transfo_matrix.linear() = transfo_matrix.rotation();
+    }
+    SE3 X_S_B_C(transfo_matrix.matrix());
+
+    //The frames are checked and written in a single transaction that takes the write lock right away, such that no other
+    // connection can change them in between. Within a transaction of the caller, a savepoint keeps the frame and its
+    // history together, which a single statement does without history.
+    bool own_transaction = sqlite3_get_autocommit(this->db->getHandle());
+    bool savepoint = !own_transaction && this->history_query;
+    if(own_transaction){
+        if(!this->begin_query){
+            this->begin_query = Prepare(*this->db, "BEGIN IMMEDIATE", this->stats.get());
+            this->commit_query = Prepare(*this->db, "COMMIT", this->stats.get());
+        }
+        this->begin_query->reset();
+        Step(*this->begin_query);
+        WRT_TRACE(begin, this->world_name.c_str(), "immediate", 0);
+    }else if(savepoint){
+        Exec(*this->db, "SAVEPOINT set_as");
+        WRT_TRACE(begin, this->world_name.c_str(), "savepoint", 0);
+    }
+    try{
+        this->Write(X_S_B_C, time);
+        if(own_transaction){
+            this->commit_query->reset();
+            Step(*this->commit_query);
+            WRT_TRACE(commit, this->world_name.c_str(), "immediate", 0);
+        }else if(savepoint){
+            Exec(*this->db, "RELEASE set_as");
+            WRT_TRACE(commit, this->world_name.c_str(), "savepoint", 0);
+        }
+    }catch(...){
+        //Undo what was written, without hiding the original error.
+        try{
+            if(own_transaction)
+                this->db->exec("ROLLBACK");
+            else if(savepoint)
+                this->db->exec("ROLLBACK TO set_as; RELEASE set_as");
+        }catch(...){}
+        throw;
+    }
+    if(own_transaction && this->stats)
+        this->stats->commits++;
+    timer.Done();
+}
+
+void CompiledSet::Write(const SE3& X_S_B_C, double time){
     /* Cases:
     * 1) R,F,I defined                          : Normal case, will overwrite previous definition
     * 2) R,I defined and F undefined            : Normal case, will introduce a new frame
@@ -113,9 +444,9 @@ void SetAs::As(Eigen::Matrix4d transformation_matrix){
     */
 
     //Check the existence of the frames
-    bool in_frame_exists = this->FrameExistsInDB(db, this->csys_name);
-    bool ref_frame_exists = this->FrameExistsInDB(db, this->basis_name);
-    bool frame_exists = this->FrameExistsInDB(db, this->subject_name);
+    bool in_frame_exists, ref_frame_exists, frame_exists;
+    string frame_parent;
+    this->FramesExistInDB(frame_exists, ref_frame_exists, in_frame_exists, frame_parent);
 
     //Case 4
     if(!ref_frame_exists && !frame_exists && this->basis_name != this->csys_name){
@@ -137,28 +468,32 @@ void SetAs::As(Eigen::Matrix4d transformation_matrix){
     //Case 3
     //If the ref_frame is undefined BUT the frame is defined, we reverse the command to SET ref_frame WRT frame AS transformation_matrix.inverse()
     if(!ref_frame_exists && frame_exists){
-        auto setter = ExpressedInSet(this->world_name, this->basis_name, this->subject_name);
+        //The reversed query is compiled once and runs in the same transaction, on the same connection.
+        if(!this->inverse)
+            this->inverse = make_shared<CompiledSet>(this->db, this->world_name, this->basis_name, this->subject_name, this->csys_name, this->validation);
         //Inverse the transformation matrix. In general, reversing a transformation matrix cannot be done by simply taking the inverse
         // as doing so assumes that the ref_frame is the same as the in_frame. This is not necessarily the case here.
-        Eigen::Matrix4d inversed_transformation_matrix = Eigen::Matrix4d::Identity();
         // R_r_f = R_f_r_Tran
-        inversed_transformation_matrix.block<3,3>(0,0) = transformation_matrix.block<3,3>(0,0).transpose();
         // p_r_f_i = - p_r_f_i
-        inversed_transformation_matrix.block<3,1>(0,3) = -1 * transformation_matrix.block<3,1>(0,3);
-        
-        setter.Ei(this->csys_name).As(inversed_transformation_matrix);
+        SE3 X_B_S_C(X_S_B_C.rotation.transpose(), -X_S_B_C.translation);
+        this->inverse->Write(X_B_S_C, time);
         return;
     }
     
     //By here, we can assume that we are dealing with case 1 or 2.
 
+    //Moving a frame to the same parent cannot create a loop, only a new frame or a new parent can.
+    if(!frame_exists || frame_parent != this->basis_name)
+        this->CheckForLoop();
+
     Eigen::Matrix3d R_C_B;
     //If the ref_frame is different from the in_frame
     if(this->basis_name != this->csys_name){
         //Take into account the fact that the transformation can be expressed in a frame different from the reference frame
         //       Like: SET object WRT table EI world
-        auto getter = ExpressedInGet(this->world_name, this->csys_name, this->basis_name);
-        auto X_C_B = getter.Ei(this->basis_name);
+        if(!this->csys_wrt_basis)
+            this->csys_wrt_basis = make_shared<CompiledGet>(this->db, this->world_name, this->csys_name, this->basis_name, this->basis_name);
+        auto X_C_B = (*this->csys_wrt_basis)();
         R_C_B = X_C_B(Eigen::seq(0,2), Eigen::seq(0,2));
     }else{
         //If the ref_frame is the same as the in_frame, the identity matrix relates them.
@@ -168,57 +503,90 @@ void SetAs::As(Eigen::Matrix4d transformation_matrix){
     // The position vector is expressed in the ref_frame through
     // p_S_B = R_C_B * p_S_B_C
     // such that the stored pose is X_S_B = [R_S_B, p_S_B; 0,0,0,1]
-    auto R = transfo_matrix.rotation();
-    auto t = R_C_B * transfo_matrix.translation(); 
-
-    SQLite::Transaction transaction(db);
-    
-    //Remove from DB any frame with  __subject_name
-    SQLite::Statement   q1(db, "DELETE FROM frames WHERE name IS ?");
-    q1.bind(1, this->subject_name);
-    q1.executeStep();
+    SE3 X_S_B = X_S_B_C.Reexpressed(R_C_B);
+    auto& R = X_S_B.rotation;
+    auto& t = X_S_B.translation;
 
-    //Store the frame built from R_S_B and p_S_B
-    SQLite::Statement   q2(db, "INSERT INTO frames VALUES (?, ?, ?,?,?, ?,?,?, ?,?,?, ?,?,?)");
+    //Store the frame built from R_S_B and p_S_B, replacing any frame with __subject_name.
+    // As() commits it, along with its history, or rolls everything back.
+    SQLite::Statement&  q2 = *this->insert_query;
+    q2.reset();
     q2.bind(1, this->subject_name);
     q2.bind(2, this->basis_name);
-    q2.bind(3,  R(0,0));
-    q2.bind(4,  R(0,1));
-    q2.bind(5,  R(0,2));
-    q2.bind(6,  R(1,0));
-    q2.bind(7,  R(1,1));
-    q2.bind(8,  R(1,2));
-    q2.bind(9,  R(2,0));
-    q2.bind(10, R(2,1));
-    q2.bind(11, R(2,2));
-    q2.bind(12, t(0));
-    q2.bind(13, t(1));
-    q2.bind(14, t(2));
-    q2.executeStep();
-
-    //Commit: Either everything is done or nothing is done.
-    transaction.commit();
-}
-
-
-ExpressedInGet::ExpressedInGet(string world_name, string subject_name, string basis_name):
-    world_name(world_name), 
-    subject_name(subject_name), 
-    basis_name(basis_name){
-    if(!VerifyInput(subject_name) || !VerifyInput(basis_name))
-        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
-    //Set the timeout to 10 seconds
-    this->timeout = 10000;
+    if(this->single_precision){
+        auto packed = PackPose(X_S_B);
+        //The statement copies the blob, which only lives until the end of the block.
+        q2.bind(3, packed.data(), PACKED_POSE_SIZE);
+        Step(q2);
+    }else{
+        q2.bind(3,  R(0,0));
+        q2.bind(4,  R(0,1));
+        q2.bind(5,  R(0,2));
+        q2.bind(6,  R(1,0));
+        q2.bind(7,  R(1,1));
+        q2.bind(8,  R(1,2));
+        q2.bind(9,  R(2,0));
+        q2.bind(10, R(2,1));
+        q2.bind(11, R(2,2));
+        q2.bind(12, t(0));
+        q2.bind(13, t(1));
+        q2.bind(14, t(2));
+        Step(q2);
+    }
+    if(!this->history_query)
+        return;
+
+    SQLite::Statement&  q3 = *this->history_query;
+    q3.reset();
+    q3.bind(1, this->subject_name);
+    q3.bind(2, time);
+    q3.bind(3, this->basis_name);
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+            q3.bind(4 + 3*i + j, R(i,j));
+    q3.bind(13, t(0));
+    q3.bind(14, t(1));
+    q3.bind(15, t(2));
+    Step(q3);
+}
+
+
+ExpressedInGet::ExpressedInGet(string_view world_name, string_view subject_name, string_view basis_name, shared_ptr<SQLite::Database> db):
+    ExpressedInGet(NameTable::Worlds().Intern(world_name), 
+        NameTable::Frames().Intern(subject_name), 
+        NameTable::Frames().Intern(basis_name), 
+        db, 
+        nullptr){}
+
+ExpressedInGet::ExpressedInGet(NameId world, NameId subject, NameId basis, shared_ptr<SQLite::Database> db, shared_ptr<CompiledGets> compiled_gets):
+    world(world), 
+    subject(subject), 
+    basis(basis),
+    db(db),
+    compiled_gets(compiled_gets){
+    //Only the busy timeout of the connection applies unless Within() is called.
+    this->timeout = 0;
 }
 
 ExpressedInGet::~ExpressedInGet(){}
 
+ExpressedInGet ExpressedInGet::At(double time){
+    ExpressedInGet query = *this;
+    query.time = time;
+    return query;
+}
+
+ExpressedInGet ExpressedInGet::Within(int timeout){
+    ExpressedInGet query = *this;
+    query.timeout = timeout;
+    return query;
+}
+
 RefFrame ExpressedInGet::GetParentFrame(string subject_name){
-    SQLite::Database db(this->world_name+".db", SQLite::OPEN_READONLY, this->timeout);
-    db.exec("PRAGMA journal_mode=WAL;");
-    db.exec("PRAGMA synchronous = off;");
+    //Reuse the connection of the query, if any, which is already set up.
+    auto db = this->db ? this->db : DbConnector::Connect(NameTable::Worlds().Name(this->world), ConnectionOptions());
 
-    SQLite::Statement   query(db, "SELECT * FROM frames WHERE name IS ?");
+    SQLite::Statement   query(*db, "SELECT * FROM frames WHERE name IS ?");
     query.bind(1, subject_name);
 
     //Values to be read from the database
@@ -235,6 +603,16 @@ RefFrame ExpressedInGet::GetParentFrame(string subject_name){
         name = query.getColumn(0).getText();
         parent_name = query.getColumn(1).getText();
 
+        if(query.getColumnCount() == 3){
+            //A pose stored in single precision, see DbConnector::SINGLE_PRECISION.
+            auto packed = query.getColumn(2);
+            auto X = UnpackPose(packed.getBlob(), packed.getBytes());
+            R00 = X.rotation(0,0); R01 = X.rotation(0,1); R02 = X.rotation(0,2);
+            R10 = X.rotation(1,0); R11 = X.rotation(1,1); R12 = X.rotation(1,2);
+            R20 = X.rotation(2,0); R21 = X.rotation(2,1); R22 = X.rotation(2,2);
+            t0 = X.translation(0); t1 = X.translation(1); t2 = X.translation(2);
+            continue;
+        }
         R00    = query.getColumn(2).getDouble();
         R01    = query.getColumn(3).getDouble();
         R02    = query.getColumn(4).getDouble();
@@ -252,9 +630,9 @@ RefFrame ExpressedInGet::GetParentFrame(string subject_name){
         t2     = query.getColumn(13).getDouble();
     }
     if(row_counter == 0)
-        throw runtime_error("The reference frame "+this->subject_name+" does not exist in this world.");
+        throw runtime_error("The reference frame "+NameTable::Frames().Name(this->subject)+" does not exist in this world.");
     if(row_counter != 1)
-        throw runtime_error("Need a single reference frame "+this->subject_name+".");
+        throw runtime_error("Need a single reference frame "+NameTable::Frames().Name(this->subject)+".");
 
     //If the value is lower than machine precision, set it to zero.
     R00 = (abs(R00) < DBL_EPSILON) ? 0 : R00;
@@ -270,184 +648,336 @@ RefFrame ExpressedInGet::GetParentFrame(string subject_name){
     t1 = (abs(t1) < DBL_EPSILON) ? 0 : t1;
     t2 = (abs(t2) < DBL_EPSILON) ? 0 : t2;
 
-    //Build a transformation matrix
-    Eigen::Affine3d tr;
-    tr.matrix() <<  R00, R01, R02, t0,
-                    R10, R11, R12, t1,
-                    R20, R21, R22, t2,
-                    0,0,0,1;
+    //Build the frame from the rotation matrix, which was verified when the frame was set.
+    Eigen::Matrix3d R;
+    R <<    R00, R01, R02,
+            R10, R11, R12,
+            R20, R21, R22;
 
-    RefFrame parent_frame(name, parent_name, tr);
+    RefFrame parent_frame(name, parent_name, Eigen::Quaterniond(R), Eigen::Vector3d(t0, t1, t2));
     return parent_frame;
 }
 
 //Return the pose of subject_name relative to world reference frame, expressed in world.
 // or if a kinematic loop is detected, return the subject_name as the parent frame.
-tuple<Eigen::Affine3d, string> ExpressedInGet::PoseWrtRoot(string subject_name){
+tuple<SE3, string> ExpressedInGet::PoseWrtRoot(string subject_name){
     RefFrame f = ExpressedInGet::GetParentFrame(subject_name);
-    Eigen::Quaterniond new_ori(f.rotation);
-    Eigen::Vector3d new_pos(f.translation);
+    SE3Quaternion X_S_R(f.rotation, f.translation);
     
     //The parent_name of the root frame is empty so we can use it as a stop condition.
     while(f.parent_name.length() > 0){
         auto parent_frame = ExpressedInGet::GetParentFrame(f.parent_name);
-        Eigen::Quaterniond ori(parent_frame.rotation);
-        Eigen::Vector3d pos(parent_frame.translation);
-        //Compute the composed orientation
-        new_ori = ori * new_ori;
-        //Compute the composed position
-        new_pos = ori * new_pos + pos;
+        //Compose the orientations and the positions
+        X_S_R = SE3Quaternion(parent_frame.rotation, parent_frame.translation) * X_S_R;
         //Go deeper in the tree
         f = parent_frame;
         //If the name of the parent frame is the same as the initial frame, we have a loop
         // and its impossible to return the pose of the frame relative to the root frame.
         if(f.name == subject_name){
-            throw runtime_error("The frame "+this->subject_name+" is part of a kinematic loop.");
+            throw runtime_error("The frame "+NameTable::Frames().Name(this->subject)+" is part of a kinematic loop.");
         }
     }
 
-    Eigen::Affine3d new_transfo = Eigen::Affine3d::Identity();
-    new_transfo.linear()        = new_ori.toRotationMatrix();
-    new_transfo.translation()   = new_pos;
-
-    return {new_transfo, f.parent_name};
-}
-
-//Return the pose of subject_name relative to root reference frame, expressed in the root frame.
-// This version is independant of the name of the root frame.
-// This version performs everything from within the database, increasing drastically the speed.
-// Currently this does not use quaternions as rotation matrices are used in the database.
-// WARNING: There is a limit of 100 recursions, if you have a kinematic link longer than that, it will fail.
-tuple<Eigen::Affine3d, string> ExpressedInGet::PoseWrtRootSQL(string subject_name){
-    SQLite::Database db(this->world_name+".db", SQLite::OPEN_READWRITE, this->timeout);
-    db.exec("PRAGMA journal_mode=WAL;");
-    db.exec("PRAGMA synchronous = off;");
-
-    //This query create a temporary table (CTE) through a recursive query that is started with the
-    // first SELECT statement, which generate a row that is then the input to the following SELECT.
-    // The second SELECT performs transform composition. So the query go from a leaf to a root,
-    // compositing the transform at each step. The third SELECT is used to get the result obtained
-    // at the end of the recursive process, without prior knowledge about the name of the root frame.
-    SQLite::Statement   query(db, "\
-    WITH RECURSIVE get_parent (i, n, p, b00, b01, b02, b10, b11, b12, b20, b21, b22, bx, by, bz) \
-    AS ( \
-        select 0, frames.* from frames where frames.name = ? \
-        UNION ALL \
-        SELECT i+1, name, parent, \
-        r00*b00+r01*b10+r02*b20, \
-        r00*b01+r01*b11+r02*b21, \
-        r00*b02+r01*b12+r02*b22, \
-        r10*b00+r11*b10+r12*b20, \
-        r10*b01+r11*b11+r12*b21, \
-        r10*b02+r11*b12+r12*b22, \
-        r20*b00+r21*b10+r22*b20, \
-        r20*b01+r21*b11+r22*b21, \
-        r20*b02+r21*b12+r22*b22, \
-        r00*bx+r01*by+r02*bz+t0, \
-        r10*bx+r11*by+r12*bz+t1, \
-        r20*bx+r21*by+r22*bz+t2 \
-        FROM frames, get_parent WHERE name = get_parent.p \
-        LIMIT 100 \
-    ) \
-    SELECT n, p, b00, b01, b02, b10, b11, b12, b20, b21, b22, bx, by, bz FROM get_parent ORDER BY i DESC LIMIT 1; \
-    ");
-    query.bind(1, subject_name);
+    return {SE3(X_S_R), f.parent_name};
+}
 
-    //Values to be read from the database
-    string name;
-    string parent_name;
-    double R00, R01, R02;
-    double R10, R11, R12;
-    double R20, R21, R22;
-    double t0, t1, t2;
-    //Verify that the frame exists.
-    int row_counter = 0;
-    while (query.executeStep()){
-        row_counter++;
-        name = query.getColumn(0).getText();
-        parent_name = query.getColumn(1).getText();
+Eigen::Matrix4d ExpressedInGet::Ei(string_view csys_name){
+    return this->Evaluate(NameTable::Frames().Intern(csys_name));
+}
 
-        R00    = query.getColumn(2).getDouble();
-        R01    = query.getColumn(3).getDouble();
-        R02    = query.getColumn(4).getDouble();
-        
-        R10    = query.getColumn(5).getDouble();
-        R11    = query.getColumn(6).getDouble();
-        R12    = query.getColumn(7).getDouble();
-        
-        R20    = query.getColumn(8).getDouble();
-        R21    = query.getColumn(9).getDouble();
-        R22    = query.getColumn(10).getDouble();
+Eigen::Matrix4d ExpressedInGet::Ei(FrameName csys_name){
+    return this->Evaluate(NameTable::Frames().Intern(csys_name));
+}
 
-        t0     = query.getColumn(11).getDouble();
-        t1     = query.getColumn(12).getDouble();
-        t2     = query.getColumn(13).getDouble();
+Eigen::Matrix4d ExpressedInGet::Evaluate(NameId csys){
+    auto& csys_name = NameTable::Frames().Name(csys);
+    //Poses at past times are rarely asked twice, their queries are compiled for a single use.
+    if(!this->compiled_gets || this->time)
+        return this->Compile(csys_name)();
+
+    //Finding the compiled query only compares integers, which does not allocate memory nor copy the handles.
+    auto key = forward_as_tuple(this->subject, this->basis, csys);
+    auto compiled = this->compiled_gets->queries.find(key);
+    if(compiled == this->compiled_gets->queries.end()){
+        //Processes going through many different frames would otherwise keep the prepared statements of all of them.
+        if(this->compiled_gets->queries.size() >= 1000)
+            this->compiled_gets->queries.clear();
+        compiled = this->compiled_gets->queries.emplace(key, this->Compile(csys_name)).first;
     }
+    return compiled->second.Within(this->timeout)();
+}
 
-    string root_name;
-    if(row_counter == 0)
-        throw runtime_error("The reference frame "+subject_name+" does not exist in this world.");
-    else{
-        if(name == "world")
-            root_name = "world";
-        else
-            root_name = parent_name;
+CompiledGet ExpressedInGet::Compile(string_view csys_name){
+    auto& world_name = NameTable::Worlds().Name(this->world);
+    auto db = this->db ? this->db : DbConnector::Connect(world_name, ConnectionOptions());
+    auto& frames = NameTable::Frames();
+    CompiledGet compiled(db, world_name, frames.Name(this->subject), frames.Name(this->basis), string(csys_name), this->time);
+    compiled.Within(this->timeout);
+    return compiled;
+}
+
+CompiledGet::CompiledGet(string world_name, string subject_name, string basis_name, string csys_name):
+    CompiledGet(DbConnector::Connect(world_name, ConnectionOptions()), world_name, subject_name, basis_name, csys_name){}
+
+CompiledGet::CompiledGet(shared_ptr<SQLite::Database> db, string world_name, string subject_name, string basis_name, string csys_name, optional<double> time):
+    world_name(world_name), 
+    subject_name(subject_name), 
+    basis_name(basis_name),
+    csys_name(csys_name),
+    db(db),
+    has_cache(false),
+    cached_data_version(0),
+    cached_total_changes(0),
+    time(time){
+    if(!VerifyInput(subject_name) || !VerifyInput(basis_name) || !VerifyInput(csys_name))
+        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
+    //Only the busy timeout of the connection applies unless Within() is called.
+    this->timeout = 0;
+    this->stats = StatsCollector::Find(world_name);
+    auto stats = this->stats.get();
+    this->version_query = Prepare(*this->db, "PRAGMA data_version;", stats);
+
+    //ReadSample() tells the two layouts of the frames table apart by their number of columns.
+    if(DbConnector::IsSinglePrecision(*this->db))
+        this->frame_query = Prepare(*this->db, "SELECT 0, parent, pose FROM frames WHERE name = ?", stats);
+    else
+        this->frame_query = Prepare(*this->db, "SELECT 0, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM frames WHERE name = ?", stats);
+
+    if(this->time){
+        //Both queries are a single search in the (name, time) primary key of the history.
+        this->before_query = Prepare(*this->db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history WHERE name = ? AND time <= ? ORDER BY time DESC LIMIT 1", stats);
+        this->after_query = Prepare(*this->db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history WHERE name = ? AND time > ? ORDER BY time ASC LIMIT 1", stats);
+        //The coarser levels only exist if a retention policy was set, see GetSet::SetRetention().
+        auto levels_exist = Prepare(*this->db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'retention'", stats);
+        if(Step(*levels_exist)){
+            auto levels = Prepare(*this->db, "SELECT level FROM retention WHERE level > 0 ORDER BY level", stats);
+            while(Step(*levels))
+                this->history_levels.push_back(levels->getColumn(0).getInt());
+            this->level_before_query = Prepare(*this->db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history_levels WHERE level = ? AND name = ? AND time <= ? ORDER BY time DESC LIMIT 1", stats);
+            this->level_after_query = Prepare(*this->db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history_levels WHERE level = ? AND name = ? AND time > ? ORDER BY time ASC LIMIT 1", stats);
+        }
+    }
+}
+
+CompiledGet::~CompiledGet(){}
+
+CompiledGet& CompiledGet::Within(int timeout){
+    this->timeout = timeout;
+    return *this;
+}
+
+//The data_version changes whenever another connection commits to the database while the number of
+// total changes accounts for what was written through this very connection.
+bool CompiledGet::CacheIsValid(){
+    SQLite::Statement& query = *this->version_query;
+    query.reset();
+    Step(query);
+    int64_t data_version = query.getColumn(0).getInt64();
+    //Release the statement so that it does not hold a read transaction on the database.
+    query.reset();
+    int64_t total_changes = sqlite3_total_changes(this->db->getHandle());
+    bool valid = this->has_cache && data_version == this->cached_data_version && total_changes == this->cached_total_changes;
+    this->cached_data_version = data_version;
+    this->cached_total_changes = total_changes;
+    return valid;
+}
+
+//Read a row made of a time, a parent name and a pose from any of the history queries.
+// Return false if the query has no result.
+bool ReadSample(SQLite::Statement& query, double& time, string& parent_name, SE3& pose, StatsCollector* stats){
+    bool found = Step(query);
+    if(found){
+        if(stats)
+            stats->rows_read++;
+        time = query.getColumn(0).getDouble();
+        parent_name = query.getColumn(1).getText();
+        if(query.getColumnCount() == 3){
+            //A pose stored in single precision, see DbConnector::SINGLE_PRECISION.
+            auto packed = query.getColumn(2);
+            pose = UnpackPose(packed.getBlob(), packed.getBytes());
+        }else{
+            for(int i = 0; i < 3; i++)
+                for(int j = 0; j < 3; j++)
+                    pose.rotation(i,j) = query.getColumn(2 + 3*i + j).getDouble();
+            for(int i = 0; i < 3; i++)
+                pose.translation(i) = query.getColumn(11 + i).getDouble();
+        }
+    }
+    //Release the statement so that it does not hold a read transaction on the database.
+    query.reset();
+    return found;
+}
+
+//Return the pose of subject_name relative to the root reference frame, expressed in the root frame.
+// Each frame costs a single search in the primary key, whatever the depth of the tree. Kinematic loops are
+// detected with Brent's algorithm: the walk is compared to a frame that is moved ahead every power of two
+// steps, which finds any loop within a few laps without remembering the frames visited.
+tuple<SE3, string> CompiledGet::PoseWrtRootCurrent(string subject_name){
+    SE3 X_S_R = SE3::Identity();
+    string name = subject_name;
+    string parent_name;
+    string tortoise = subject_name;
+    size_t power = 1, steps = 0, depth = 0;
+    SQLite::Statement& query = *this->frame_query;
+    while(true){
+        SE3 X_F_P;
+        double unused;
+        query.reset();
+        query.bind(1, name);
+        if(!ReadSample(query, unused, parent_name, X_F_P, this->stats.get())){
+            if(name == subject_name)
+                throw runtime_error("The reference frame "+subject_name+" does not exist in this world.");
+            //The parent of the previous frame is undefined, it is the root of the tree.
+            break;
+        }
+        X_S_R = X_F_P * X_S_R;
+        depth++;
+        //The root of the tree has no parent.
+        if(parent_name.empty())
+            break;
+        name = parent_name;
+        if(name == tortoise)
+            throw runtime_error("The frame "+subject_name+" is part of a kinematic loop.");
+        if(++steps == power){
+            tortoise = name;
+            power *= 2;
+            steps = 0;
+        }
     }
 
+    if(this->stats)
+        this->stats->depth.Record(depth);
     //If the value is lower than machine precision, set it to zero.
-    R00 = (abs(R00) < DBL_EPSILON) ? 0 : R00;
-    R01 = (abs(R01) < DBL_EPSILON) ? 0 : R01;
-    R02 = (abs(R02) < DBL_EPSILON) ? 0 : R02;
-    R10 = (abs(R10) < DBL_EPSILON) ? 0 : R10;
-    R11 = (abs(R11) < DBL_EPSILON) ? 0 : R11;
-    R12 = (abs(R12) < DBL_EPSILON) ? 0 : R12;
-    R20 = (abs(R20) < DBL_EPSILON) ? 0 : R20;
-    R21 = (abs(R21) < DBL_EPSILON) ? 0 : R21;
-    R22 = (abs(R22) < DBL_EPSILON) ? 0 : R22;
-    t0 = (abs(t0) < DBL_EPSILON) ? 0 : t0;
-    t1 = (abs(t1) < DBL_EPSILON) ? 0 : t1;
-    t2 = (abs(t2) < DBL_EPSILON) ? 0 : t2;
+    auto RoundToZero = [](double value){ return abs(value) < DBL_EPSILON ? 0.0 : value; };
+    X_S_R.rotation = X_S_R.rotation.unaryExpr(RoundToZero);
+    X_S_R.translation = X_S_R.translation.unaryExpr(RoundToZero);
+    return {X_S_R, name};
+}
 
-    //Build a transformation matrix
-    Eigen::Affine3d tr;
-    tr.matrix() <<  R00, R01, R02, t0,
-                    R10, R11, R12, t1,
-                    R20, R21, R22, t2,
-                    0,0,0,1;
+tuple<SE3, string> CompiledGet::PoseWrtRootAt(string subject_name){
+    double time = *this->time;
+    SE3 X_S_R = SE3::Identity();
+    //Names of the frames already visited, to detect kinematic loops.
+    set<string> visited;
+    string name = subject_name;
+    while(true){
+        if(!visited.insert(name).second)
+            throw runtime_error("The frame "+subject_name+" is part of a kinematic loop.");
 
-    return {tr, root_name};
+        double before_time, after_time;
+        string parent_name, after_parent_name;
+        SE3 X_before, X_after;
+        SQLite::Statement& before = *this->before_query;
+        before.reset();
+        before.bind(1, name);
+        before.bind(2, time);
+        bool has_before = ReadSample(before, before_time, parent_name, X_before, this->stats.get());
+        SQLite::Statement& after = *this->after_query;
+        after.reset();
+        after.bind(1, name);
+        after.bind(2, time);
+        bool has_after = ReadSample(after, after_time, after_parent_name, X_after, this->stats.get());
+        //The samples at that time may only remain in a coarser level.
+        for(size_t i = 0; i < this->history_levels.size() && !has_before; i++){
+            SQLite::Statement& level_before = *this->level_before_query;
+            level_before.reset();
+            level_before.bind(1, this->history_levels[i]);
+            level_before.bind(2, name);
+            level_before.bind(3, time);
+            has_before = ReadSample(level_before, before_time, parent_name, X_before, this->stats.get());
+            if(has_before){
+                SQLite::Statement& level_after = *this->level_after_query;
+                level_after.reset();
+                level_after.bind(1, this->history_levels[i]);
+                level_after.bind(2, name);
+                level_after.bind(3, time);
+                //Use the nearest of the following samples, in this level or in the history table.
+                double level_after_time;
+                string level_after_parent_name;
+                SE3 X_level_after;
+                if(ReadSample(level_after, level_after_time, level_after_parent_name, X_level_after, this->stats.get()) && (!has_after || level_after_time < after_time)){
+                    has_after = true;
+                    after_time = level_after_time;
+                    after_parent_name = level_after_parent_name;
+                    X_after = X_level_after;
+                }
+            }
+        }
+
+        SE3 X_F_P;
+        if(has_before && has_after && parent_name == after_parent_name){
+            //Interpolate between the two samples surrounding the time.
+            double alpha = (time - before_time) / (after_time - before_time);
+            X_F_P = SE3(Interpolate(SE3Quaternion(X_before), SE3Quaternion(X_after), alpha));
+        }else if(has_before){
+            //The last sample holds until the next one, which is also the case when the parent changed.
+            X_F_P = X_before;
+        }else if(has_after){
+            throw runtime_error("The reference frame "+name+" did not exist yet at time "+to_string(time)+".");
+        }else{
+            //Frames that were never recorded, such as the world frame, keep their current pose.
+            SQLite::Statement& current = *this->frame_query;
+            current.reset();
+            current.bind(1, name);
+            double unused;
+            if(!ReadSample(current, unused, parent_name, X_F_P, this->stats.get())){
+                if(name == subject_name)
+                    throw runtime_error("The reference frame "+subject_name+" does not exist in this world.");
+                //The parent of the previous frame is undefined, it is the root of the tree.
+                if(this->stats)
+                    this->stats->depth.Record(visited.size() - 1);
+                return {X_S_R, name};
+            }
+        }
+        X_S_R = X_F_P * X_S_R;
+        //The root of the tree has no parent.
+        if(parent_name.empty()){
+            if(this->stats)
+                this->stats->depth.Record(visited.size());
+            return {X_S_R, name};
+        }
+        name = parent_name;
+    }
 }
 
-Eigen::Matrix4d ExpressedInGet::Ei(string csys_name){
-    this->csys_name = csys_name;
-    if(!VerifyInput(csys_name))
-        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
+Eigen::Matrix4d CompiledGet::operator()(){
+    OperationTrace trace(this->world_name, this->subject_name, true);
+    OperationTimer timer(this->stats.get(), true);
+    CallDeadline deadline(this->timeout);
+    //Nothing changed in the database since the last evaluation, the previous result still holds.
+    if(this->CacheIsValid()){
+        timer.Done();
+        return this->cached_pose;
+    }
+    this->has_cache = false;
+    auto PoseWrtRoot = [this](string name){
+        return this->time ? this->PoseWrtRootAt(name) : this->PoseWrtRootCurrent(name);
+    };
 
     //Get subject_name WRT root EI root
-    auto [X_S_W, frame_root_name] = PoseWrtRootSQL(this->subject_name);
+    auto [X_S_W, frame_root_name] = PoseWrtRoot(this->subject_name);
 
     //Get basis_name WRT root EI root
-    auto X_B_W = Eigen::Affine3d::Identity();
+    SE3 X_B_W = SE3::Identity();
     auto ref_root_name = this->basis_name;
     if(frame_root_name == this->basis_name){
         //The root frame is the basis_name so X_B_W is identity and there is nothing to do.
     }else{
         //Otherwise, we need to find its pose relative to the root.
-        auto [pose, root_name] = PoseWrtRootSQL(this->basis_name);
+        auto [pose, root_name] = PoseWrtRoot(this->basis_name);
         X_B_W = pose;
         ref_root_name = root_name;
     }
-    auto R_B_W   = X_B_W.rotation();
 
     //Get csys_name WRT root EI root
-    auto X_C_W = Eigen::Affine3d::Identity();
+    SE3 X_C_W = SE3::Identity();
     if(frame_root_name == ref_root_name){
-        if(frame_root_name == csys_name){
+        if(frame_root_name == this->csys_name){
             //The root frame is already the frame in which we want to express the transform
             // so X_C_W is identity and there is nothing to do.
         }else{
             //Otherwise, we need to find its pose relative to the root.
-            auto [pose, in_root_name] = PoseWrtRootSQL(this->csys_name);
+            auto [pose, in_root_name] = PoseWrtRoot(this->csys_name);
             X_C_W = pose;
             //Make sure all three frames have the same root frame
             if(ref_root_name != in_root_name){
@@ -458,40 +988,42 @@ Eigen::Matrix4d ExpressedInGet::Ei(string csys_name){
         throw runtime_error("The frame "+this->subject_name+" cannot be defined with respect to "+this->basis_name+". Is the frame graph complete?");
     }
 
-    //Get root WRT ref EI root
-    auto X_W_B = X_B_W.inverse();
-    Eigen::Affine3d X_W_B_W = Eigen::Affine3d::Identity();
-    X_W_B_W.linear()        = X_W_B.rotation();
-    X_W_B_W.translation()   = -1 * X_B_W.translation();
-
-    //Compute the subject_name WRT basis_name EI root
-    auto X_S_B = X_W_B * X_S_W;
-    auto R_S_B   = X_S_B.rotation();
+    //Compute the subject_name WRT basis_name EI basis_name, the inverse of a rigid transformation being a transpose.
+    SE3 X_S_B = X_B_W.Inverse() * X_S_W;
 
     //Change the "expressed in"
     // To represent a position vector (ref_frame --> frame), a coordinate system (in_frame) needs to be chosen.
     // Rotations are not expressed in a coordinate system (no in_frame involved).
-    // p_S_B = R_C_B * p_S_B_C
-    auto X_W_C = X_C_W.inverse();
-    auto R_W_C   = X_W_C.rotation();
-    Eigen::Affine3d X_S_B_C = Eigen::Affine3d::Identity();
-    X_S_B_C.linear()        = R_S_B;
-    X_S_B_C.translation()   = R_W_C * R_B_W * X_S_B.translation();
-    return X_S_B_C.matrix();
+    // p_S_B_C = R_W_C * R_B_W * p_S_B
+    SE3 X_S_B_C = X_S_B.Reexpressed(X_B_W.rotation).Reexpressed(X_C_W.rotation.transpose());
+    this->cached_pose = X_S_B_C.Matrix();
+    //A pose read in a transaction is not reused, as the changes it saw are undone if the transaction is rolled back.
+    this->has_cache = sqlite3_get_autocommit(this->db->getHandle());
+    timer.Done();
+    return this->cached_pose;
 }
 
 
-ExpressedInSet::ExpressedInSet(string world_name, string subject_name, string basis_name): 
-    world_name(world_name), 
-    subject_name(subject_name), 
-    basis_name(basis_name){
-    //Set the timeout to 10 seconds
-    this->timeout = 10000;
-}
+ExpressedInSet::ExpressedInSet(string_view world_name, string_view subject_name, string_view basis_name, shared_ptr<SQLite::Database> db): 
+    ExpressedInSet(NameTable::Worlds().Intern(world_name), 
+        NameTable::Frames().Intern(subject_name), 
+        NameTable::Frames().Intern(basis_name), 
+        db,
+        PoseValidation::Strict){}
+
+ExpressedInSet::ExpressedInSet(NameId world, NameId subject, NameId basis, shared_ptr<SQLite::Database> db, PoseValidation validation): 
+    world(world), 
+    subject(subject), 
+    basis(basis),
+    db(db),
+    validation(validation){}
 
 ExpressedInSet::~ExpressedInSet(){}
 
-SetAs ExpressedInSet::Ei(string csys_name){
-    this->csys_name = csys_name;
-    return SetAs(this->world_name, this->subject_name, this->basis_name, this->csys_name);
+SetAs ExpressedInSet::Ei(string_view csys_name){
+    return SetAs(this->world, this->subject, this->basis, NameTable::Frames().Intern(csys_name), this->db, this->validation);
+}
+
+SetAs ExpressedInSet::Ei(FrameName csys_name){
+    return SetAs(this->world, this->subject, this->basis, NameTable::Frames().Intern(csys_name), this->db, this->validation);
 }
\ No newline at end of file
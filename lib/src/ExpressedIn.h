@@ -3,13 +3,32 @@
 //Forward declaration
 class ExpressedInGet;
 class ExpressedInSet;
+class CompiledGet;
+class CompiledSet;
+struct CompiledGets;
 
 #include "DbConnector.h"
+#include "ConnectionOptions.h"
+#include "Busy.h"
+#include "Trace.h"
+#include "NameTable.h"
+#include "Pose.h"
 #include <Eigen/Eigen>
 #include <Eigen/Geometry>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <map>
+#include <tuple>
 using namespace std;
 
+/**
+ * @brief Current time in seconds since the epoch, used to timestamp the poses recorded in the history.
+ */
+double CurrentTime();
+
 /**
  * @brief Defines a reference frame in relation to its parent frame through a rigid transformation.
  */
@@ -50,25 +69,18 @@ class RefFrame{
  */
 class SetAs{
     private:
-        /// Name of the world/database to work in.
-        string world_name;
-        /// Name of the subject frame.
-        string subject_name;
-        /// Name of the basis frame.
-        string basis_name;
-        /// Name of the coordinate system in which the transformation/pose is expressed.
-        string csys_name;
-        /// Timeout in milliseconds for the operation, default is 10 seconds.
+        /// Path to the world/database to work in, see NameTable::Worlds().
+        NameId world;
+        /// Names of the subject frame, of the basis frame and of the coordinate system in which the transformation/pose is expressed, see NameTable::Frames().
+        NameId subject;
+        NameId basis;
+        NameId csys;
+        /// Time in milliseconds the operation can wait for locks held by other connections, 0 to only use the busy timeout of the connection.
         int timeout;
-        /**
-         * @brief Check if the specified frame exists in the supplied (opened) database.
-         * 
-         * @param database: A reference to an open connection to the database.
-         * @param frame: Name of the frame to check.
-         * 
-         * @return true if the frame exists, false otherwise.
-         */
-        bool FrameExistsInDB(SQLite::Database& database, string frame);
+        /// Connection to the database shared with the rest of the query, opened on demand if empty.
+        shared_ptr<SQLite::Database> db;
+        /// How the pose is validated, see ConnectionOptions::validation.
+        PoseValidation validation;
     public:
         /**
          * @brief Interface to the As() operator. Do not use this class directly. For internal use only.
@@ -77,10 +89,17 @@ class SetAs{
          * @param subject_name: Name of the subject frame to Set().
          * @param basis_name: Name of the basis frame.
          * @param csys_name: Name of the coordinate system in which the transformation/pose is expressed.
+         * @param db: Connection to the database to use, a new one is opened if empty.
          * 
          * @throw runtime_error: If the name of any frame contains invalid characters.
          */
-        SetAs(string world_name, string subject_name, string basis_name, string csys_name);
+        SetAs(string_view world_name, string_view subject_name, string_view basis_name, string_view csys_name, shared_ptr<SQLite::Database> db = nullptr);
+        /**
+         * @brief Same as above with interned names, which are already validated. For internal use only.
+         * 
+         * @param validation: How the pose is validated, see ConnectionOptions::validation.
+         */
+        SetAs(NameId world, NameId subject, NameId basis, NameId csys, shared_ptr<SQLite::Database> db, PoseValidation validation);
         ~SetAs();
         /**
          * @brief Used to specify the transformation defining the pose of the frame with respect to the basis frame and expressed in the selected coordinate system.
@@ -88,14 +107,189 @@ class SetAs{
          * @note Calling this function will overwrite any previously defined frame with the same name.
          * 
          * @throw runtime_error: If the query is incorrect or if the transformation matrix is invalid.
+         * @throw TimeoutError: If another connection held a lock needed by the operation for too long.
          */
         void As(Eigen::Matrix4d transformation_matrix);
+        /**
+         * @brief Same as As() but the pose is recorded in the history of the world, if any, as being valid from the specified time on.
+         * 
+         * @param time: Time in seconds since the epoch, the current time is used by the other overload.
+         */
+        void As(Eigen::Matrix4d transformation_matrix, double time);
+        /**
+         * @brief Same as As() with the pose in another representation, see CompiledSet::As().
+         */
+        void As(const Eigen::Isometry3d& pose);
+        void As(const Eigen::Isometry3d& pose, double time);
+        void As(const Eigen::Isometry3f& pose);
+        void As(const Eigen::Isometry3f& pose, double time);
+        void As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation);
+        void As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation, double time);
+        void As(const PoseArray& pose);
+        void As(const PoseArray& pose, double time);
+        /**
+         * @brief Validate the query once and return a handle that can be used to repeatedly Set the frame at a low cost.
+         * 
+         * @note The handle keeps a connection to the database and the prepared statements alive for its whole lifetime.
+         * 
+         * @return CompiledSet Handle exposing the As() method.
+         */
+        CompiledSet Compile();
+        /**
+         * @brief Bound the time the operation waits for locks held by other connections, regardless of the busy timeout of the connection.
+         * 
+         * @note Example: In("world").Set("frame").Wrt("reference_frame").Ei("expressed_in_frame").Within(5).As(matrix).
+         * 
+         * @param timeout: Time in milliseconds, after which the operation fails with a TimeoutError.
+         * @return SetAs Interface to the As() operator.
+         */
+        SetAs Within(int timeout);
 };
 
 /**
- * @brief Interface to the Ei() method to which the name of the coordinate system is passed when performing a Get() operation.
+ * @brief Pre-validated Get() query that can be evaluated many times without re-parsing or re-planning it.
+ * 
+ * The handle validates the frame names once, keeps a connection to the database and the prepared statements, 
+ * and caches the poses of the frames relative to the root of their tree. The cache is only refreshed when the 
+ * content of the database changed since the last evaluation.
+ * 
+ * Example:
+ * 
+ *     auto gripper_in_camera = wrt.In("lab").Get("gripper").Wrt("camera").Compile("camera");
+ *     Eigen::Matrix4d pose = gripper_in_camera();
  */
-class ExpressedInGet
+class CompiledGet
+{
+private:
+    /// Name of the world/database to work in.
+    string world_name;
+    /// Name of the subject frame.
+    string subject_name;
+    /// Name of the basis frame.
+    string basis_name;
+    /// Name of the coordinate system in which the transformation/pose is expressed.
+    string csys_name;
+    /// Time in milliseconds the operation can wait for locks held by other connections, 0 to only use the busy timeout of the connection.
+    int timeout;
+    /// Connection to the database, possibly shared with other handles.
+    shared_ptr<SQLite::Database> db;
+    /// Prepared query returning a number that changes whenever another connection modifies the database.
+    shared_ptr<SQLite::Statement> version_query;
+    /// Whether cached_pose holds the result of a previous evaluation.
+    bool has_cache;
+    /// Value of PRAGMA data_version when cached_pose was computed.
+    int64_t cached_data_version;
+    /// Number of rows modified through this connection when cached_pose was computed.
+    int64_t cached_total_changes;
+    /// Result of the last evaluation.
+    Eigen::Matrix4d cached_pose;
+    /// Time at which the poses are desired, the current poses are used if empty.
+    optional<double> time;
+    /// Prepared queries returning the samples of the history right before and right after the time, only used if time is set.
+    shared_ptr<SQLite::Statement> before_query;
+    shared_ptr<SQLite::Statement> after_query;
+    /// Prepared query returning the current pose of a frame relative to its parent.
+    shared_ptr<SQLite::Statement> frame_query;
+    /// Same as before_query and after_query for the coarser levels of the history, only used if the world has a retention policy.
+    shared_ptr<SQLite::Statement> level_before_query;
+    shared_ptr<SQLite::Statement> level_after_query;
+    /// Coarser levels of the history, from the finest to the coarsest.
+    vector<int> history_levels;
+    /// Statistics of the world, only if they are collected, see DbConnector::COLLECT_STATS.
+    shared_ptr<StatsCollector> stats;
+    /**
+     * @brief Compute the pose of the specified frame relative to the root of its tree (the only frame with no parent in the tree).
+     * 
+     * @note The tree is walked up one frame at a time with a prepared query, such that the cost is linear in the depth of the
+     *  frame and that there is no limit on the depth.
+     * 
+     * @throw runtime_error: If the frame does not exist or is part of a kinematic loop.
+     * 
+     * @param subject_name Name of the frame whose pose is desired.
+     * @return tuple<SE3 pose, string root_name> where the pose is the transformation defining the pose of the frame with respect to the root frame whose name is root_name. 
+     */
+    tuple<SE3, string> PoseWrtRootCurrent(string subject_name);
+    /**
+     * @brief Compute the pose of the specified frame relative to the root of its tree at this->time, walking up the tree one frame at a time.
+     * 
+     * @note The pose of each frame relative to its parent is interpolated between the two samples of the history surrounding the time,
+     *  with a SLERP for the orientation and a linear interpolation for the position. Frames that were never recorded keep their current pose.
+     *  Once the samples at that time were removed from the history by the retention policy, the finest level still holding them is used.
+     * 
+     * @throw runtime_error: If a frame did not exist yet at that time.
+     * 
+     * @param subject_name Name of the frame whose pose is desired.
+     * @return tuple<SE3 pose, string root_name> Same as PoseWrtRootCurrent().
+     */
+    tuple<SE3, string> PoseWrtRootAt(string subject_name);
+    /**
+     * @brief Check if the database changed since the last evaluation.
+     * 
+     * @return true if the cached pose can be returned as is, false otherwise.
+     */
+    bool CacheIsValid();
+public:
+    /**
+     * @brief Prepare a Get() query. Prefer using ExpressedInGet::Compile().
+     * 
+     * @param world_name: Name of the world/database to work in.
+     * @param subject_name: Name of the subject frame to Get().
+     * @param basis_name: Name of the basis frame.
+     * @param csys_name: Name of the coordinate system in which the transformation/pose is expressed.
+     * 
+     * @throw runtime_error: If the name of any frame contains invalid characters.
+     */
+    CompiledGet(string world_name, string subject_name, string basis_name, string csys_name);
+    /**
+     * @brief Prepare a Get() query on an already opened connection. For internal use only.
+     * 
+     * @param db: Connection to the database of the world.
+     * @param time: Time in seconds since the epoch at which the pose is desired, the current pose is used if empty.
+     */
+    CompiledGet(shared_ptr<SQLite::Database> db, string world_name, string subject_name, string basis_name, string csys_name, optional<double> time = nullopt);
+    ~CompiledGet();
+    /**
+     * @brief Evaluate the query.
+     * 
+     * @throw runtime_error: If there is a problem with the pose graph.
+     * @throw TimeoutError: If another connection held a lock needed by the evaluation for too long.
+     * 
+     * @return Eigen::Matrix4d Pose of the frame with respect to the selected basis and expressed in the chosen coordinate system.
+     */
+    Eigen::Matrix4d operator()();
+    /**
+     * @brief Same as operator()() but the pose is returned in another representation, see ConvertPose().
+     * 
+     * @note Example: PoseArray pose = get_gripper.Evaluate<PoseArray>().
+     */
+    template<typename Pose>
+    Pose Evaluate(){ return ConvertPose<Pose>((*this)()); }
+    /**
+     * @brief Bound the time each evaluation waits for locks held by other connections, regardless of the busy timeout of the connection.
+     * 
+     * @param timeout: Time in milliseconds, after which an evaluation fails with a TimeoutError, 0 to only use the busy timeout.
+     * @return CompiledGet& This handle.
+     */
+    CompiledGet& Within(int timeout);
+};
+
+/**
+ * @brief Compiled Get() queries of the current poses, shared by the queries started from the same GetSet object. For internal use only.
+ */
+struct CompiledGets{
+    /// Compiled queries indexed by the names of their subject frame, basis frame and coordinate system.
+    map<tuple<NameId, NameId, NameId>, CompiledGet, less<>> queries;
+};
+
+/**
+ * @brief Pre-validated Set() query that can be evaluated many times without re-parsing it.
+ * 
+ * Example:
+ * 
+ *     auto set_gripper = wrt.In("lab").Set("gripper").Wrt("table").Ei("table").Compile();
+ *     set_gripper.As(pose);
+ */
+class CompiledSet
 {
 private:
     /// Name of the world/database to work in.
@@ -106,8 +300,158 @@ private:
     string basis_name;
     /// Name of the coordinate system in which the transformation/pose is expressed.
     string csys_name;
-    /// Timeout in milliseconds for the operation, default is 10 seconds.
+    /// Time in milliseconds the operation can wait for locks held by other connections, 0 to only use the busy timeout of the connection.
+    int timeout;
+    /// Connection to the database.
+    shared_ptr<SQLite::Database> db;
+    /// Prepared query used to check the existence of the frames.
+    shared_ptr<SQLite::Statement> exists_query;
+    /// Prepared queries returning the parent of a frame and whether a frame has children, used to detect kinematic loops.
+    shared_ptr<SQLite::Statement> parent_query;
+    shared_ptr<SQLite::Statement> children_query;
+    /// Prepared query storing the new definition of the subject frame.
+    shared_ptr<SQLite::Statement> insert_query;
+    /// True if the world stores the poses in single precision, see DbConnector::SINGLE_PRECISION.
+    bool single_precision;
+    /// How the poses are validated before being stored, see ConnectionOptions::validation.
+    PoseValidation validation;
+    /// Prepared query recording the new definition in the history, only if the world records its history.
+    shared_ptr<SQLite::Statement> history_query;
+    /// Compiled query giving the orientation of the coordinate system relative to the basis, only used when they differ.
+    shared_ptr<CompiledGet> csys_wrt_basis;
+    /// Statistics of the world, only if they are collected, see DbConnector::COLLECT_STATS.
+    shared_ptr<StatsCollector> stats;
+    /// Prepared statements starting and committing the transaction of As(), only used outside of a transaction of the caller.
+    shared_ptr<SQLite::Statement> begin_query;
+    shared_ptr<SQLite::Statement> commit_query;
+    /// Compiled query setting the basis frame relative to the subject frame, used when only the subject frame exists.
+    shared_ptr<CompiledSet> inverse;
+    /**
+     * @brief Check which of the subject, basis and csys frames exist in the database.
+     * 
+     * @param subject_exists: Set to true if the subject frame exists, false otherwise.
+     * @param basis_exists: Set to true if the basis frame exists, false otherwise.
+     * @param csys_exists: Set to true if the csys frame exists, false otherwise.
+     * @param subject_parent: Set to the current parent of the subject frame, if it exists.
+     */
+    void FramesExistInDB(bool& subject_exists, bool& basis_exists, bool& csys_exists, string& subject_parent);
+    /**
+     * @brief Check that making the basis frame the parent of the subject frame does not close a kinematic loop,
+     *  by walking up the tree from the basis frame if the subject frame has children.
+     * 
+     * @throw runtime_error: If the subject frame is the basis frame or one of its ancestors.
+     */
+    void CheckForLoop();
+    /**
+     * @brief Check the frames and write the new definition of the subject frame, or of the basis frame if the command
+     *  must be reversed, within the transaction started by As().
+     * 
+     * @param X_S_B_C: Pose of the subject frame relative to the basis frame and expressed in the csys frame.
+     * @param time: Time from which the definition is valid in the history.
+     */
+    void Write(const SE3& X_S_B_C, double time);
+    /**
+     * @brief Write the pose in a transaction, see As().
+     * 
+     * @param transfo_matrix: Transformation relative to the basis frame and expressed in the csys frame.
+     * @param time: Time from which the definition is valid in the history.
+     * @param precision: Largest deviation from a rotation matrix due to the precision of the input, checked according to
+     *  the validation policy, or 0 if the linear part is known to be a rotation matrix, such as when it was built from a
+     *  unit quaternion.
+     * 
+     * @throw runtime_error: If the transformation is rejected by the validation policy.
+     */
+    void Store(Eigen::Affine3d transfo_matrix, double time, double precision);
+public:
+    /**
+     * @brief Prepare a Set() query. Prefer using SetAs::Compile().
+     * 
+     * @param world_name: Name of the world/database to work in.
+     * @param subject_name: Name of the subject frame to Set().
+     * @param basis_name: Name of the basis frame.
+     * @param csys_name: Name of the coordinate system in which the transformation/pose is expressed.
+     * 
+     * @throw runtime_error: If the name of any frame contains invalid characters, if the subject is the world frame or if
+     *  it is the same as the basis frame.
+     */
+    CompiledSet(string world_name, string subject_name, string basis_name, string csys_name);
+    /**
+     * @brief Prepare a Set() query on an already opened connection. For internal use only.
+     * 
+     * @param db: Connection to the database of the world.
+     * @param validation: How the poses are validated, see ConnectionOptions::validation.
+     */
+    CompiledSet(shared_ptr<SQLite::Database> db, string world_name, string subject_name, string basis_name, string csys_name,
+        PoseValidation validation = PoseValidation::Strict);
+    ~CompiledSet();
+    /**
+     * @brief Used to specify the transformation defining the pose of the frame with respect to the basis frame and expressed in the selected coordinate system.
+     * 
+     * @note Calling this function will overwrite any previously defined frame with the same name.
+     * 
+     * @throw runtime_error: If the query is incorrect, if the transformation matrix is rejected by the validation policy,
+     *  see ConnectionOptions::validation, or if the new parent of the frame is one of its descendants.
+     */
+    void As(Eigen::Matrix4d transformation_matrix);
+    /**
+     * @brief Same as As() but the pose is recorded in the history of the world, if any, as being valid from the specified time on.
+     * 
+     * @param time: Time in seconds since the epoch, the current time is used by the other overload.
+     */
+    void As(Eigen::Matrix4d transformation_matrix, double time);
+    /**
+     * @brief Same as As() with the pose as an isometry, which is verified like a matrix.
+     */
+    void As(const Eigen::Isometry3d& pose);
+    void As(const Eigen::Isometry3d& pose, double time);
+    /**
+     * @brief Same as As() with the pose in single precision, checked to the precision of a float and whose rotation is
+     *  orthonormalized in double precision, unless the validation policy is trusted.
+     */
+    void As(const Eigen::Isometry3f& pose);
+    void As(const Eigen::Isometry3f& pose, double time);
+    /**
+     * @brief Same as As() with the orientation as a quaternion and the position as a vector.
+     * 
+     * @note The quaternion is normalized and converted to a rotation matrix directly, such that the pose needs no other verification.
+     * 
+     * @throw runtime_error: If the quaternion is zero or is not finite, or if the translation is not finite.
+     */
+    void As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation);
+    void As(const Eigen::Quaterniond& rotation, const Eigen::Vector3d& translation, double time);
+    /**
+     * @brief Same as As() with the pose as [x, y, z, qx, qy, qz, qw], see PoseArray.
+     */
+    void As(const PoseArray& pose);
+    void As(const PoseArray& pose, double time);
+    /**
+     * @brief Bound the time each call to As() waits for locks held by other connections, regardless of the busy timeout of the connection.
+     * 
+     * @param timeout: Time in milliseconds, after which a call fails with a TimeoutError, 0 to only use the busy timeout.
+     * @return CompiledSet& This handle.
+     */
+    CompiledSet& Within(int timeout);
+};
+
+/**
+ * @brief Interface to the Ei() method to which the name of the coordinate system is passed when performing a Get() operation.
+ */
+class ExpressedInGet
+{
+private:
+    /// Path to the world/database to work in, see NameTable::Worlds().
+    NameId world;
+    /// Names of the subject frame and of the basis frame, see NameTable::Frames().
+    NameId subject;
+    NameId basis;
+    /// Time in milliseconds the operation can wait for locks held by other connections, 0 to only use the busy timeout of the connection.
     int timeout;
+    /// Connection to the database shared with the rest of the query, opened on demand if empty.
+    shared_ptr<SQLite::Database> db;
+    /// Time at which the pose is desired, the current pose is used if empty.
+    optional<double> time;
+    /// Compiled queries shared by the queries started from the same GetSet object, nullptr to compile each query for a single use.
+    shared_ptr<CompiledGets> compiled_gets;
     /**
      * @brief Get the definition of the parent frame of the specified frame as a RefFrame object.
      * 
@@ -118,21 +462,16 @@ private:
     /**
      * @brief (DEPRECATED) Compute the pose of the specified frame relative to the root of its tree (the only frame with no parent in the tree).
      * 
-     * @note DEPRECATED. PoseWrtRootSQL() is much faster.
+     * @note DEPRECATED. CompiledGet is much faster.
      * 
      * @param subject_name Name of the frame whose pose is desired.
-     * @return tuple<Eigen::Affine3d pose, string> where the pose is the transformation matrix defining the pose of the frame with respect to the root frame and expressed in the root frame. The string is empty. 
+     * @return tuple<SE3 pose, string> where the pose is the transformation defining the pose of the frame with respect to the root frame and expressed in the root frame. The string is empty. 
      */
-    tuple<Eigen::Affine3d, string> PoseWrtRoot(string subject_name);
+    tuple<SE3, string> PoseWrtRoot(string subject_name);
     /**
-     * @brief Compute the pose of the specified frame relative to the root of its tree (the only frame with no parent in the tree).
-     * 
-     * @note The name of the function comes from the fact that all computations are done directly from within the database, hence its speed.
-     * 
-     * @param subject_name Name of the frame whose pose is desired.
-     * @return tuple<Eigen::Affine3d pose, string root_name> where the pose is the transformation matrix defining the pose of the frame with respect to the root frame whose name is root_name. 
+     * @brief Evaluate the query in the specified coordinate system, see Ei().
      */
-    tuple<Eigen::Affine3d, string> PoseWrtRootSQL(string subject_name);
+    Eigen::Matrix4d Evaluate(NameId csys);
 public:
     /**
      * @brief Interface to the Ei() operator. Do not use this class directly. For internal use only.
@@ -140,22 +479,73 @@ public:
      * @param world_name: Name of the world/database to work in.
      * @param subject_name: Name of the subject frame to Get().
      * @param basis_name: Name of the basis frame.
+     * @param db: Connection to the database to use, a new one is opened if empty.
      * 
      * @throw runtime_error: If the name of any frame contains invalid characters.
      */
-    ExpressedInGet(string world_name, string subject_name, string basis_name);
+    ExpressedInGet(string_view world_name, string_view subject_name, string_view basis_name, shared_ptr<SQLite::Database> db = nullptr);
+    /**
+     * @brief Same as above with interned names, which are already validated. For internal use only.
+     * 
+     * @param compiled_gets: Compiled queries reused by Ei(), nullptr to compile each query for a single use.
+     */
+    ExpressedInGet(NameId world, NameId subject, NameId basis, shared_ptr<SQLite::Database> db, shared_ptr<CompiledGets> compiled_gets);
     ~ExpressedInGet();
+    /**
+     * @brief Ask for the pose at a past time instead of the current pose, using the history of the world.
+     * 
+     * @note The world must record its history, see DbConnector::RECORD_HISTORY. Example: In("world").Get("frame").Wrt("reference_frame").At(t).Ei("expressed_in_frame").
+     * 
+     * @param time: Time in seconds since the epoch.
+     * @return ExpressedInGet Interface to the Ei() operator.
+     */
+    ExpressedInGet At(double time);
+    /**
+     * @brief Bound the time the operation waits for locks held by other connections, regardless of the busy timeout of the connection.
+     * 
+     * @note Example: In("world").Get("frame").Wrt("reference_frame").Within(5).Ei("expressed_in_frame").
+     * 
+     * @param timeout: Time in milliseconds, after which the operation fails with a TimeoutError.
+     * @return ExpressedInGet Interface to the Ei() operator.
+     */
+    ExpressedInGet Within(int timeout);
     /**
      * @brief Used to specify the name of the coordinate system used to represent the pose of the subject frame relative to the basis frame.
      * 
-     * @note Calling this function will trigger reading the database to answer the query.
+     * @note Calling this function will trigger reading the database to answer the query. The query is compiled the first
+     *  time it is made from a GetSet object and reused by the following ones, which do not allocate memory when the
+     *  database did not change in between.
      * 
      * @throw runtime_error: If the name of any frame contains invalid characters or if there is a problem with the pose graph.
      * 
      * @param csys_name: Name of the coordinate system used to represent the pose of the frame.
      * @return Eigen::Matrix4d Pose of the frame with respect to the selected basis and expressed in the chosen coordinate system.
      */
-    Eigen::Matrix4d Ei(string csys_name);
+    Eigen::Matrix4d Ei(string_view csys_name);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "table"_frame, see FrameName.
+     */
+    Eigen::Matrix4d Ei(FrameName csys_name);
+    /**
+     * @brief Same as Ei() but the pose is returned in another representation, see ConvertPose().
+     * 
+     * @note Example: Eigen::Isometry3d pose = In("world").Get("frame").Wrt("reference_frame").Ei<Eigen::Isometry3d>("expressed_in_frame").
+     */
+    template<typename Pose>
+    Pose Ei(string_view csys_name){ return ConvertPose<Pose>(this->Ei(csys_name)); }
+    template<typename Pose>
+    Pose Ei(FrameName csys_name){ return ConvertPose<Pose>(this->Ei(csys_name)); }
+    /**
+     * @brief Validate the query once and return a handle that can be evaluated repeatedly at a low cost.
+     * 
+     * @note The handle keeps a connection to the database and the prepared statements alive for its whole lifetime.
+     * 
+     * @throw runtime_error: If the name of any frame contains invalid characters.
+     * 
+     * @param csys_name: Name of the coordinate system used to represent the pose of the frame.
+     * @return CompiledGet Handle that returns the pose of the frame when called.
+     */
+    CompiledGet Compile(string_view csys_name);
 };
 
 /**
@@ -164,16 +554,15 @@ public:
 class ExpressedInSet
 {
 private:
-    /// Name of the world/database to work in.
-    string world_name;
-    /// Name of the subject frame.
-    string subject_name;
-    /// Name of the basis frame.
-    string basis_name;
-    /// Name of the coordinate system in which the transformation/pose is expressed.
-    string csys_name;
-    /// Timeout in milliseconds for the operation, default is 10 seconds.
-    int timeout;
+    /// Path to the world/database to work in, see NameTable::Worlds().
+    NameId world;
+    /// Names of the subject frame and of the basis frame, see NameTable::Frames().
+    NameId subject;
+    NameId basis;
+    /// Connection to the database shared with the rest of the query, opened on demand if empty.
+    shared_ptr<SQLite::Database> db;
+    /// How the pose is validated, see ConnectionOptions::validation.
+    PoseValidation validation;
 public:
     /**
      * @brief Interface to the Ei() operator. Do not use this class directly. For internal use only.
@@ -181,10 +570,17 @@ public:
      * @param world_name: Name of the world/database to work in.
      * @param subject_name: Name of the subject frame to Get().
      * @param basis_name: Name of the basis frame.
+     * @param db: Connection to the database to use, a new one is opened if empty.
      * 
      * @throw runtime_error: If the name of any frame contains invalid characters.
      */
-    ExpressedInSet(string world_name, string subject_name, string basis_name);
+    ExpressedInSet(string_view world_name, string_view subject_name, string_view basis_name, shared_ptr<SQLite::Database> db = nullptr);
+    /**
+     * @brief Same as above with interned names, which are already validated. For internal use only.
+     * 
+     * @param validation: How the pose is validated, see ConnectionOptions::validation.
+     */
+    ExpressedInSet(NameId world, NameId subject, NameId basis, shared_ptr<SQLite::Database> db, PoseValidation validation);
     ~ExpressedInSet();
     /**
      * @brief Used to specify the name of the coordinate system used to represent the pose of the subject frame relative to the basis frame.
@@ -194,5 +590,9 @@ public:
      * @param csys_name: Name of the coordinate system used to represent the pose of the frame.
      * @return SetAs Interface to the As() function used to specify the transformation matrix.
      */
-    SetAs Ei(string csys_name);
+    SetAs Ei(string_view csys_name);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "table"_frame, see FrameName.
+     */
+    SetAs Ei(FrameName csys_name);
 };
\ No newline at end of file
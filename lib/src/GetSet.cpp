@@ -1,17 +1,85 @@
 #include "GetSet.h"
+#include "Snapshot.h"
+#include "History.h"
 
-GetSet::GetSet(string world_name): world_name(world_name){}
+GetSet::GetSet(string world_name, ConnectionOptions options): world_name(world_name), options(options){
+    this->world = NameTable::Worlds().Intern(this->world_name);
+    this->validation = this->options.ValidationPolicy();
+}
+
+GetSet::GetSet(const GetSet& other):
+    world_name(other.world_name),
+    world(other.world),
+    options(other.options),
+    validation(other.validation){}
+
+GetSet& GetSet::operator=(const GetSet& other){
+    //The connection and the compiled queries of the other object are not safe to use from another thread.
+    this->world_name = other.world_name;
+    this->world = other.world;
+    this->db.reset();
+    this->compiled_gets.reset();
+    this->options = other.options;
+    this->validation = other.validation;
+    return *this;
+}
 
 GetSet::~GetSet(){}
 
-WrtGet GetSet::Get(string subject_name){
-    this->subject_name = subject_name;
-    return WrtGet(this->world_name, this->subject_name);
+shared_ptr<SQLite::Database> GetSet::Connection(){
+    if(!this->db){
+        this->db = DbConnector::Connect(this->world_name, this->options);
+        //The compiled queries hold prepared statements of this very connection.
+        this->compiled_gets = make_shared<CompiledGets>();
+    }
+    return this->db;
+}
+
+WrtGet GetSet::Get(string_view subject_name){
+    auto db = this->Connection();
+    return WrtGet(this->world, NameTable::Frames().Intern(subject_name), db, this->compiled_gets);
 }
 
-WrtSet GetSet::Set(string subject_name){
+WrtGet GetSet::Get(FrameName subject_name){
+    auto db = this->Connection();
+    return WrtGet(this->world, NameTable::Frames().Intern(subject_name), db, this->compiled_gets);
+}
+
+WrtSet GetSet::Set(string_view subject_name){
     if(subject_name == "world")
         throw runtime_error("Cannot change the 'world' reference frame as it's assumed to be an inertial/immobile frame.");
-    this->subject_name = subject_name;
-    return WrtSet(this->world_name, this->subject_name);
+    return WrtSet(this->world, NameTable::Frames().Intern(subject_name), this->Connection(), this->validation);
+}
+
+WrtSet GetSet::Set(FrameName subject_name){
+    if(subject_name.Name() == "world")
+        throw runtime_error("Cannot change the 'world' reference frame as it's assumed to be an inertial/immobile frame.");
+    return WrtSet(this->world, NameTable::Frames().Intern(subject_name), this->Connection(), this->validation);
+}
+
+void GetSet::Export(string path){
+    Snapshot::Export(*this->Connection(), path);
+}
+
+void GetSet::Import(string path){
+    Snapshot snapshot(path);
+    snapshot.LoadInto(*this->Connection());
+}
+
+void GetSet::SetRetention(vector<RetentionLevel> levels){
+    SetRetentionPolicy(*this->Connection(), levels);
+}
+
+vector<PoseSample> GetSet::History(string subject_name, double start, double end, double resolution){
+    return ReadHistory(*this->Connection(), subject_name, start, end, resolution);
+}
+
+WorldStats GetSet::Stats(){
+    auto stats = StatsCollector::Find(this->world_name);
+    return stats ? stats->Read() : WorldStats();
+}
+
+
+WorldTransaction GetSet::Transaction(bool read_only){
+    return WorldTransaction(this->world_name, this->Connection(), read_only);
 }
\ No newline at end of file
@@ -2,10 +2,20 @@
 
 //Forward declaration
 class GetSet;
+struct RetentionLevel;
+struct PoseSample;
+struct CompiledGets;
 
 #include "DbConnector.h"
+#include "ConnectionOptions.h"
+#include "Stats.h"
 #include "WrtGetSet.h"
+#include "WorldTransaction.h"
+#include "NameTable.h"
 #include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
 using namespace std;
 
 /**
@@ -15,21 +25,55 @@ using namespace std;
  * In("world").Get("frame").Wrt("reference_frame").Ei("expressed_in_frame") 
  * or 
  * In("world").Set("frame").Wrt("reference_frame").Ei("expressed_in_frame").As(matrix).
+ * 
+ * All the queries started from the same GetSet object share a single connection to the database, 
+ * such that keeping the object around avoids re-opening the database for every query.
+ *
+ * @warning A GetSet object is not thread-safe. A copy opens its own connection and keeps its own compiled queries,
+ *  such that each thread should work on its own copy of the object.
  */
 class GetSet
 {
+    friend class BulkWriter;
+    friend class Compactor;
+    friend class Daemon;
 private:
     /// Name of the world/database to work in.
     string world_name;
-    /// Name of the frame to Get/Set.
-    string subject_name;
+    /// Same as world_name, interned such that the queries do not copy it, see NameTable::Worlds().
+    NameId world;
+    /// Connection to the database shared by all queries, opened on the first query.
+    shared_ptr<SQLite::Database> db;
+    /// Get() queries compiled on the connection, reused by the queries asking for the same frames.
+    shared_ptr<CompiledGets> compiled_gets;
+    /// Settings applied to the connection when it is opened.
+    ConnectionOptions options;
+    /// How the poses given to Set() are validated, see ConnectionOptions::validation.
+    PoseValidation validation;
+    /**
+     * @brief Get the connection to the database of the world, opening it if needed.
+     */
+    shared_ptr<SQLite::Database> Connection();
 public:
     /**
      * @brief Interface to the Get/Set operators. Do not use this class directly. For internal use only.
      * 
      * @param world_name: Name of the frame to Get/Set.
+     * @param options: Settings applied to the connection to the database.
+     * 
+     * @throw runtime_error: If the validation policy of the settings is unknown.
      */
-    GetSet(string world_name);
+    GetSet(string world_name, ConnectionOptions options = ConnectionOptions());
+    /**
+     * @brief Copy the world and settings of another object, but not its connection nor its compiled queries, such that
+     *  the copy can be used by another thread.
+     * 
+     * @param other: Object to copy.
+     */
+    GetSet(const GetSet& other);
+    GetSet& operator=(const GetSet& other);
+    GetSet(GetSet&& other) = default;
+    GetSet& operator=(GetSet&& other) = default;
     ~GetSet();
     /**
      * @brief Define the operation type (Get) and the frame to perform it on.
@@ -39,7 +83,11 @@ public:
      * @param subject_frame: Name of the frame to Get.
      * @return WrtGet Interface to the Wrt() operator.
      */
-    WrtGet Get(string subject_frame);
+    WrtGet Get(string_view subject_frame);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "gripper"_frame, see FrameName.
+     */
+    WrtGet Get(FrameName subject_frame);
     /**
      * @brief Define the operation type (Set) and the frame to perform it on.
      * 
@@ -50,5 +98,83 @@ public:
      * @param subject_frame: Name of the frame to Set.
      * @return WrtSet Interface to the Wrt() operator.
      */
-    WrtSet Set(string subject_frame);
+    WrtSet Set(string_view subject_frame);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "gripper"_frame, see FrameName.
+     */
+    WrtSet Set(FrameName subject_frame);
+    /**
+     * @brief Write a binary snapshot of the world to a file, see Snapshot.
+     * 
+     * @param path: Path to the snapshot file, replaced atomically if it exists.
+     */
+    void Export(string path);
+    /**
+     * @brief Replace the content of the world by the content of a binary snapshot, in a single transaction.
+     * 
+     * @note Queries running on other connections see either the previous content of the world or the content of the snapshot.
+     * 
+     * @throw runtime_error: If the file is not a valid snapshot.
+     * 
+     * @param path: Path to the snapshot file.
+     */
+    void Import(string path);
+    /**
+     * @brief Set how long the history of the world is kept and at which resolution, see RetentionLevel.
+     * 
+     * @note The policy is applied by a Compactor, which must be run regularly.
+     * 
+     * Example: keep every sample for a minute, one sample per second for an hour and one sample per minute for a day.
+     * 
+     *     world.SetRetention({{0, 60}, {1, 3600}, {60, 86400}});
+     * 
+     * @throw runtime_error: If the world does not record its history or if the levels are not ordered from the finest to the coarsest.
+     * 
+     * @param levels: Levels of the history, from the finest to the coarsest.
+     */
+    void SetRetention(vector<RetentionLevel> levels);
+    /**
+     * @brief Get the recorded poses of a frame relative to its parent within a period of time.
+     * 
+     * @note The samples are read from the coarsest level of the history that still covers the start of the period and whose
+     *  resolution is at least as fine as requested, such that long periods are read from the coarse levels.
+     * 
+     * @param subject_name: Name of the frame.
+     * @param start: Beginning of the period, in seconds since the epoch.
+     * @param end: End of the period, in seconds since the epoch.
+     * @param resolution: Coarsest acceptable time in seconds between two samples, 0 to get every sample still recorded.
+     * @return vector<PoseSample> Samples ordered by time.
+     */
+    vector<PoseSample> History(string subject_name, double start, double end, double resolution = 0);
+    /**
+     * @brief Get the statistics collected by this process on the world since it was opened with DbConnector::COLLECT_STATS.
+     * 
+     * Example: Printing the 99th percentile of the latency of the Get() operations.
+     * 
+     *     auto world = DbConnector(DbConnector::COLLECT_STATS).In("lab");
+     *     world.Get("gripper").Wrt("table").Ei("table");
+     *     cout << world.Stats().get_latency.Quantile(0.99) << " ns" << endl;
+     * 
+     * @return WorldStats Copy of the counters and histograms, all zeros if the statistics of the world are not collected.
+     */
+    WorldStats Stats();
+    /**
+     * @brief Start a transaction in which the following queries of this object run, until it is committed or destroyed, see WorldTransaction.
+     * 
+     * Example: Reading two frames in the same state of the world.
+     * 
+     *     auto transaction = world.Transaction(true);
+     *     auto gripper = world.Get("gripper").Wrt("world").Ei("world");
+     *     auto cup = world.Get("cup").Wrt("world").Ei("world");
+     *     transaction.Commit();
+     * 
+     * @throw TimeoutError: If another connection held the write lock for longer than the busy timeout.
+     * @throw runtime_error: If a transaction is already running in this world.
+     * 
+     * @param read_only: True to only Get() from a snapshot of the world, without preventing other processes from
+     *  setting frames in the meantime. False to also Set() frames, in which case the other processes wait for the
+     *  transaction to end before setting frames.
+     * @return WorldTransaction Transaction, rolled back when destroyed unless committed.
+     */
+    WorldTransaction Transaction(bool read_only = false);
 };
\ No newline at end of file
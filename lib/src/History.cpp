@@ -0,0 +1,334 @@
+#include "History.h"
+#include "ExpressedIn.h"
+#include <cmath>
+#include <chrono>
+#include <stdexcept>
+using namespace std;
+
+/*
+* The retention policy of a world is stored in the table
+*   retention(level, resolution, duration, compacted_time, compacted_name)
+* where level 0 describes the history table itself and the other levels are stored in
+*   history_levels(level, name, time, parent, R00, ..., t2)
+* Each level holds a copy of the first sample of each frame in every interval of *resolution* seconds, made from
+* the history table. All the rows of the history table before (compacted_time, compacted_name) were already copied.
+*/
+
+//Read the levels of the retention policy, from the finest to the coarsest. The first level is the history table.
+vector<tuple<int, RetentionLevel, double, string>> ReadRetentionLevels(SQLite::Database& db){
+    vector<tuple<int, RetentionLevel, double, string>> levels;
+    SQLite::Statement retention_exists(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'retention'");
+    if(!retention_exists.executeStep())
+        return levels;
+    SQLite::Statement query(db, "SELECT level, resolution, duration, compacted_time, compacted_name FROM retention ORDER BY level");
+    while(query.executeStep()){
+        RetentionLevel level = {query.getColumn(1).getDouble(), query.getColumn(2).getDouble()};
+        levels.push_back({query.getColumn(0).getInt(), level, query.getColumn(3).getDouble(), query.getColumn(4).getText()});
+    }
+    return levels;
+}
+
+void SetRetentionPolicy(SQLite::Database& db, const vector<RetentionLevel>& levels){
+    SQLite::Statement history_exists(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'history'");
+    if(!history_exists.executeStep())
+        throw runtime_error("The world does not record its history, see DbConnector::RECORD_HISTORY.");
+    history_exists.reset();
+    if(levels.empty() || levels[0].resolution != 0)
+        throw runtime_error("The first level of the retention policy must have a resolution of 0 as it holds every sample.");
+    for(size_t i = 0; i < levels.size(); i++){
+        if(!(levels[i].duration > 0))
+            throw runtime_error("The duration of each level of the retention policy must be positive.");
+        if(i > 0 && !(levels[i].resolution > levels[i-1].resolution && levels[i].duration > levels[i-1].duration))
+            throw runtime_error("Each level of the retention policy must be coarser and kept longer than the previous one.");
+    }
+
+    db.exec("BEGIN IMMEDIATE");
+    try{
+        db.exec("CREATE TABLE IF NOT EXISTS retention( \
+                        level INTEGER PRIMARY KEY, \
+                        resolution REAL, \
+                        duration REAL, \
+                        compacted_time REAL, \
+                        compacted_name TEXT \
+                    );");
+        db.exec("CREATE TABLE IF NOT EXISTS history_levels( \
+                        level INTEGER, \
+                        name TEXT, \
+                        time REAL, \
+                        parent TEXT, \
+                        R00 REAL, \
+                        R01 REAL, \
+                        R02 REAL, \
+                        R10 REAL, \
+                        R11 REAL, \
+                        R12 REAL, \
+                        R20 REAL, \
+                        R21 REAL, \
+                        R22 REAL, \
+                        t0 REAL, \
+                        t1 REAL, \
+                        t2 REAL, \
+                        PRIMARY KEY (level, name, time) \
+                    ) WITHOUT ROWID;");
+        //Finding the oldest samples of each level, whatever the frame.
+        db.exec("CREATE INDEX IF NOT EXISTS history_time ON history(time);");
+        db.exec("CREATE INDEX IF NOT EXISTS history_levels_time ON history_levels(level, time);");
+
+        //Levels whose resolution changed must be rebuilt from the samples still in the history table.
+        auto previous_levels = ReadRetentionLevels(db);
+        SQLite::Statement clear_level(db, "DELETE FROM history_levels WHERE level = ?");
+        SQLite::Statement insert_level(db, "INSERT OR REPLACE INTO retention VALUES (?, ?, ?, ?, ?)");
+        for(size_t i = 0; i < levels.size(); i++){
+            double compacted_time = -INFINITY;
+            string compacted_name = "";
+            if(i < previous_levels.size() && get<1>(previous_levels[i]).resolution == levels[i].resolution){
+                compacted_time = get<2>(previous_levels[i]);
+                compacted_name = get<3>(previous_levels[i]);
+            }else{
+                clear_level.reset();
+                clear_level.bind(1, (int)i);
+                clear_level.exec();
+            }
+            insert_level.reset();
+            insert_level.bind(1, (int)i);
+            insert_level.bind(2, levels[i].resolution);
+            insert_level.bind(3, levels[i].duration);
+            insert_level.bind(4, compacted_time);
+            insert_level.bind(5, compacted_name);
+            insert_level.exec();
+        }
+        SQLite::Statement remove_levels(db, "DELETE FROM retention WHERE level >= ?");
+        remove_levels.bind(1, (int)levels.size());
+        remove_levels.exec();
+        SQLite::Statement remove_samples(db, "DELETE FROM history_levels WHERE level >= ?");
+        remove_samples.bind(1, (int)levels.size());
+        remove_samples.exec();
+        db.exec("COMMIT");
+    }catch(...){
+        //Undo what was written, without hiding the original error.
+        try{ db.exec("ROLLBACK"); }catch(...){}
+        throw;
+    }
+}
+
+//Read the columns time, parent, R00, ..., t2 of a row starting at the specified column.
+PoseSample ReadPoseSample(SQLite::Statement& query, int first_column){
+    PoseSample sample;
+    sample.time = query.getColumn(first_column).getDouble();
+    sample.parent_name = query.getColumn(first_column + 1).getText();
+    sample.pose = Eigen::Matrix4d::Identity();
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+            sample.pose(i,j) = query.getColumn(first_column + 2 + 3*i + j).getDouble();
+    for(int i = 0; i < 3; i++)
+        sample.pose(i,3) = query.getColumn(first_column + 11 + i).getDouble();
+    return sample;
+}
+
+vector<PoseSample> ReadHistory(SQLite::Database& db, const string& subject_name, double start, double end, double resolution){
+    //Among the levels that still cover the start of the period, read the coarsest that is fine enough,
+    // or the finest one if none is fine enough. If none covers the start, read the one going the furthest back.
+    auto levels = ReadRetentionLevels(db);
+    double now = CurrentTime();
+    int selected = 0;
+    if(!levels.empty()){
+        selected = get<0>(levels.back());
+        bool found = false;
+        for(auto const& [level, retention, compacted_time, compacted_name] : levels){
+            if(now - retention.duration > start)
+                continue;
+            if(!found || retention.resolution <= resolution)
+                selected = level;
+            found = true;
+        }
+    }
+
+    vector<PoseSample> samples;
+    if(selected == 0){
+        SQLite::Statement query(db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history WHERE name = ? AND time >= ? AND time <= ? ORDER BY time");
+        query.bind(1, subject_name);
+        query.bind(2, start);
+        query.bind(3, end);
+        while(query.executeStep())
+            samples.push_back(ReadPoseSample(query, 0));
+    }else{
+        SQLite::Statement query(db, "SELECT time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history_levels WHERE level = ? AND name = ? AND time >= ? AND time <= ? ORDER BY time");
+        query.bind(1, selected);
+        query.bind(2, subject_name);
+        query.bind(3, start);
+        query.bind(4, end);
+        while(query.executeStep())
+            samples.push_back(ReadPoseSample(query, 0));
+    }
+    return samples;
+}
+
+Compactor::Compactor(GetSet world, size_t rows_per_step): rows_per_step(max(rows_per_step, size_t(1))), stop_requested(false){
+    this->db = DbConnector::Connect(world.world_name, world.options);
+}
+
+Compactor::~Compactor(){
+    this->Stop();
+}
+
+bool Compactor::Step(){
+    double now = CurrentTime();
+    bool more = false;
+
+    this->db->exec("BEGIN IMMEDIATE");
+    try{
+        auto levels = ReadRetentionLevels(*this->db);
+        if(levels.empty()){
+            this->db->exec("COMMIT");
+            return false;
+        }
+        //The tables of the levels exist once a retention policy was set, such that the statements can be prepared.
+        if(!this->new_samples)
+            this->Prepare();
+        SQLite::Statement& new_samples = *this->new_samples;
+        SQLite::Statement& bucket_used = *this->bucket_used;
+        SQLite::Statement& insert_sample = *this->insert_sample;
+        SQLite::Statement& update_watermark = *this->update_watermark;
+        //Copy the new samples of the history table into each coarser level.
+        //Samples of the history table that were not copied into every level yet must be kept.
+        double oldest_pending = INFINITY;
+        for(size_t i = 1; i < levels.size(); i++){
+            auto& [level, retention, compacted_time, compacted_name] = levels[i];
+            new_samples.reset();
+            new_samples.bind(1, compacted_time);
+            new_samples.bind(2, compacted_name);
+            new_samples.bind(3, (int64_t)this->rows_per_step);
+            size_t count = 0;
+            while(new_samples.executeStep()){
+                count++;
+                string name = new_samples.getColumn(0).getText();
+                PoseSample sample = ReadPoseSample(new_samples, 1);
+                //Keep the first sample of each interval.
+                double bucket_start = floor(sample.time / retention.resolution) * retention.resolution;
+                bucket_used.reset();
+                bucket_used.bind(1, level);
+                bucket_used.bind(2, name);
+                bucket_used.bind(3, bucket_start);
+                bucket_used.bind(4, bucket_start + retention.resolution);
+                bool used = bucket_used.executeStep();
+                bucket_used.reset();
+                if(!used){
+                    insert_sample.reset();
+                    insert_sample.bind(1, level);
+                    insert_sample.bind(2, name);
+                    insert_sample.bind(3, sample.time);
+                    insert_sample.bind(4, sample.parent_name);
+                    for(int r = 0; r < 3; r++)
+                        for(int c = 0; c < 3; c++)
+                            insert_sample.bind(5 + 3*r + c, sample.pose(r,c));
+                    for(int r = 0; r < 3; r++)
+                        insert_sample.bind(14 + r, sample.pose(r,3));
+                    insert_sample.exec();
+                }
+                compacted_time = sample.time;
+                compacted_name = name;
+            }
+            new_samples.reset();
+            update_watermark.reset();
+            update_watermark.bind(1, compacted_time);
+            update_watermark.bind(2, compacted_name);
+            update_watermark.bind(3, level);
+            update_watermark.exec();
+            more |= count == this->rows_per_step;
+            oldest_pending = min(oldest_pending, count == this->rows_per_step ? compacted_time : INFINITY);
+        }
+
+        //Remove the oldest samples of each level, the history table first.
+        for(size_t i = 0; i < levels.size(); i++){
+            auto& [level, retention, compacted_time, compacted_name] = levels[i];
+            double cutoff = now - retention.duration;
+            if(i == 0)
+                cutoff = min(cutoff, oldest_pending);
+            SQLite::Statement& old_samples = i == 0 ? *this->old_history : *this->old_level_samples;
+            SQLite::Statement& remove = i == 0 ? *this->remove_history : *this->remove_level_sample;
+            old_samples.reset();
+            old_samples.bind(1, cutoff);
+            old_samples.bind(2, (int64_t)this->rows_per_step);
+            if(i > 0)
+                old_samples.bind(3, level);
+            vector<pair<string, double>> keys;
+            while(old_samples.executeStep())
+                keys.push_back({old_samples.getColumn(0).getText(), old_samples.getColumn(1).getDouble()});
+            old_samples.reset();
+            for(auto const& [name, time] : keys){
+                remove.reset();
+                remove.bind(1, name);
+                remove.bind(2, time);
+                if(i > 0)
+                    remove.bind(3, level);
+                remove.exec();
+            }
+            more |= keys.size() == this->rows_per_step;
+        }
+        this->db->exec("COMMIT");
+    }catch(...){
+        //Undo what was written, without hiding the original error.
+        try{ this->db->exec("ROLLBACK"); }catch(...){}
+        throw;
+    }
+    return more;
+}
+
+void Compactor::Prepare(){
+    this->new_samples = make_shared<SQLite::Statement>(*this->db, "SELECT name, time, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM history WHERE (time, name) > (?, ?) ORDER BY time, name LIMIT ?");
+    this->bucket_used = make_shared<SQLite::Statement>(*this->db, "SELECT 1 FROM history_levels WHERE level = ? AND name = ? AND time >= ? AND time < ? LIMIT 1");
+    this->insert_sample = make_shared<SQLite::Statement>(*this->db, "INSERT OR REPLACE INTO history_levels VALUES (?, ?, ?, ?, ?,?,?, ?,?,?, ?,?,?, ?,?,?)");
+    this->update_watermark = make_shared<SQLite::Statement>(*this->db, "UPDATE retention SET compacted_time = ?, compacted_name = ? WHERE level = ?");
+    //The most recent sample of each frame before the cutoff ?1 is kept, as it still gives the pose of the frame
+    // at the cutoff and after it, until the next sample.
+    this->old_history = make_shared<SQLite::Statement>(*this->db, "SELECT name, time FROM history AS old WHERE time < ?1 "
+        "AND time < (SELECT max(time) FROM history WHERE name = old.name AND time < ?1) ORDER BY time LIMIT ?2");
+    this->old_level_samples = make_shared<SQLite::Statement>(*this->db, "SELECT name, time FROM history_levels AS old WHERE level = ?3 AND time < ?1 "
+        "AND time < (SELECT max(time) FROM history_levels WHERE level = ?3 AND name = old.name AND time < ?1) ORDER BY time LIMIT ?2");
+    this->remove_history = make_shared<SQLite::Statement>(*this->db, "DELETE FROM history WHERE name = ?1 AND time = ?2");
+    this->remove_level_sample = make_shared<SQLite::Statement>(*this->db, "DELETE FROM history_levels WHERE name = ?1 AND time = ?2 AND level = ?3");
+}
+
+void Compactor::Start(double period){
+    this->Stop();
+    this->stop_requested = false;
+    this->last_error.clear();
+    this->worker = thread([this, period](){
+        unique_lock<mutex> lock(this->stop_mutex);
+        while(!this->stop_requested){
+            lock.unlock();
+            try{
+                while(this->Step()){
+                    //Let the writers in between the steps.
+                    lock.lock();
+                    bool stop = this->stop_requested;
+                    lock.unlock();
+                    if(stop)
+                        break;
+                }
+            }catch(const std::exception& err){
+                //The database may be busy or locked for too long, try again later, keeping the error for LastError().
+                lock.lock();
+                this->last_error = err.what();
+                lock.unlock();
+            }
+            lock.lock();
+            this->stop_condition.wait_for(lock, chrono::duration<double>(period), [this](){ return this->stop_requested; });
+        }
+    });
+}
+
+string Compactor::LastError(){
+    lock_guard<mutex> lock(this->stop_mutex);
+    return this->last_error;
+}
+
+void Compactor::Stop(){
+    {
+        lock_guard<mutex> lock(this->stop_mutex);
+        this->stop_requested = true;
+    }
+    this->stop_condition.notify_all();
+    if(this->worker.joinable())
+        this->worker.join();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+//Forward declaration
+class Compactor;
+
+#include "GetSet.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <Eigen/Eigen>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+/**
+ * @brief Level of the history of a world: samples are kept at the specified resolution for the specified duration.
+ *
+ * The first level holds the poses as they were written, hence its resolution must be 0. Each following level keeps
+ * the first sample of each frame in every interval of *resolution* seconds and must be coarser and kept longer than
+ * the previous one. Samples older than the duration of the last level are dropped.
+ */
+struct RetentionLevel{
+    /// Minimum time in seconds between two samples of the same frame, 0 to keep every sample.
+    double resolution;
+    /// Age in seconds after which the samples are removed from this level.
+    double duration;
+};
+
+/**
+ * @brief Pose of a frame relative to its parent, valid from the specified time on.
+ */
+struct PoseSample{
+    /// Time in seconds since the epoch.
+    double time;
+    /// Name of the parent frame at that time.
+    string parent_name;
+    /// Pose of the frame with respect to its parent and expressed in its parent.
+    Eigen::Matrix4d pose;
+};
+
+/**
+ * @brief Replace the retention policy of a world that records its history. For internal use only, see GetSet::SetRetention().
+ *
+ * @throw runtime_error: If the world does not record its history or if the levels are not ordered from the finest to the coarsest.
+ */
+void SetRetentionPolicy(SQLite::Database& db, const vector<RetentionLevel>& levels);
+
+/**
+ * @brief Read the samples of a frame within a period of time. For internal use only, see GetSet::History().
+ */
+vector<PoseSample> ReadHistory(SQLite::Database& db, const string& subject_name, double start, double end, double resolution);
+
+/**
+ * @brief Applies the retention policy of a world incrementally: copies the new samples into the coarser levels and
+ *  removes the samples that are too old.
+ *
+ * Each step only processes a bounded number of rows in a short transaction, such that writers are never blocked for long.
+ * The compactor uses its own connection to the database and can run in a background thread.
+ *
+ * Example:
+ *
+ *     auto world = DbConnector(DbConnector::RECORD_HISTORY).In("lab");
+ *     world.SetRetention({{0, 60}, {1, 3600}, {60, 86400}});
+ *     auto compactor = Compactor(world);
+ *     compactor.Start(1.0);
+ */
+class Compactor
+{
+    private:
+        /// Connection used only by the compactor.
+        shared_ptr<SQLite::Database> db;
+        /// Maximum number of rows processed by each task of a step.
+        size_t rows_per_step;
+        /// Thread running the compaction in the background, if started.
+        thread worker;
+        /// Protects stop_requested and last_error.
+        mutex stop_mutex;
+        /// Wakes up the worker when it must stop.
+        condition_variable stop_condition;
+        /// Set to true to make the worker return.
+        bool stop_requested;
+        /// Message of the last error of the background compaction, empty if none.
+        string last_error;
+        /// Statements copying the new samples of the history table into the coarser levels, prepared once by Prepare().
+        shared_ptr<SQLite::Statement> new_samples;
+        shared_ptr<SQLite::Statement> bucket_used;
+        shared_ptr<SQLite::Statement> insert_sample;
+        shared_ptr<SQLite::Statement> update_watermark;
+        /// Statements finding and removing the samples older than the duration of their level.
+        shared_ptr<SQLite::Statement> old_history;
+        shared_ptr<SQLite::Statement> old_level_samples;
+        shared_ptr<SQLite::Statement> remove_history;
+        shared_ptr<SQLite::Statement> remove_level_sample;
+        /**
+         * @brief Prepare the statements used by Step(), once the tables of the retention policy exist.
+         */
+        void Prepare();
+    public:
+        /**
+         * @brief Prepare the compaction of a world.
+         *
+         * @param world: World whose history is compacted.
+         * @param rows_per_step: Maximum number of rows processed by each task of a step, which bounds the duration of the transactions.
+         */
+        Compactor(GetSet world, size_t rows_per_step = 1000);
+        Compactor(const Compactor&) = delete;
+        Compactor& operator=(const Compactor&) = delete;
+        /**
+         * @brief Stops the background compaction, if started.
+         */
+        ~Compactor();
+        /**
+         * @brief Perform a bounded amount of compaction in a single transaction.
+         *
+         * @return true if more work remains to be done, false otherwise.
+         */
+        bool Step();
+        /**
+         * @brief Compact the history in a background thread until Stop() is called.
+         *
+         * @param period: Time in seconds to wait once the history is compacted before checking it again.
+         */
+        void Start(double period);
+        /**
+         * @brief Get the error that made the last step of the background compaction fail, such as a timeout.
+         *
+         * @note The compaction is retried after the period given to Start(), the error is kept until it is restarted.
+         *
+         * @return string Message of the error, empty if no step failed since Start().
+         */
+        string LastError();
+        /**
+         * @brief Stop the background compaction and wait for the current step to finish.
+         */
+        void Stop();
+};
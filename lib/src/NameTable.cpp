@@ -0,0 +1,131 @@
+#include "NameTable.h"
+#include <stdexcept>
+using namespace std;
+
+NameId::NameId(): table(nullptr), entry(nullptr), index(0){}
+
+NameId::NameId(NameTable* table, NameEntry* entry, uint32_t index): table(table), entry(entry), index(index){}
+
+NameId::NameId(const NameId& other): table(other.table), entry(other.entry), index(other.index){
+    //The other handle keeps the entry alive, such that it can be counted without locking the table.
+    if(this->entry)
+        this->entry->references.fetch_add(1, memory_order_relaxed);
+}
+
+NameId::NameId(NameId&& other) noexcept: table(other.table), entry(other.entry), index(other.index){
+    other.table = nullptr;
+    other.entry = nullptr;
+}
+
+NameId& NameId::operator=(const NameId& other){
+    if(this->entry != other.entry){
+        NameId copy(other);
+        *this = move(copy);
+    }
+    return *this;
+}
+
+NameId& NameId::operator=(NameId&& other) noexcept{
+    if(this != &other){
+        this->Release();
+        this->table = other.table;
+        this->entry = other.entry;
+        this->index = other.index;
+        other.table = nullptr;
+        other.entry = nullptr;
+    }
+    return *this;
+}
+
+NameId::~NameId(){
+    this->Release();
+}
+
+void NameId::Release(){
+    if(this->entry && this->entry->references.fetch_sub(1, memory_order_acq_rel) == 1)
+        this->table->Release(this->index);
+    this->table = nullptr;
+    this->entry = nullptr;
+}
+
+NameTable::NameTable(bool frame_names): frame_names(frame_names){}
+
+NameId NameTable::Intern(string_view name, uint64_t hash, bool validated){
+    lock_guard<mutex> lock(this->names_mutex);
+    //Different names rarely share a hash, in which case they are told apart by comparing them.
+    auto [first, last] = this->ids.equal_range(hash);
+    for(auto id = first; id != last; id++){
+        auto& entry = this->entries[id->second];
+        if(entry.name == name){
+            entry.references.fetch_add(1, memory_order_relaxed);
+            return NameId(this, &entry, id->second);
+        }
+    }
+
+    if(this->frame_names && !validated && !VerifyInput(name))
+        throw runtime_error("Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
+    uint32_t index;
+    if(!this->free_entries.empty()){
+        index = this->free_entries.back();
+        this->free_entries.pop_back();
+    }else{
+        index = this->entries.size();
+        this->entries.emplace_back();
+    }
+    auto& entry = this->entries[index];
+    entry.name = name;
+    entry.hash = hash;
+    entry.used = true;
+    entry.references.store(1, memory_order_relaxed);
+    this->ids.emplace(hash, index);
+    return NameId(this, &entry, index);
+}
+
+NameId NameTable::Intern(string_view name){
+    return this->Intern(name, HashName(name), false);
+}
+
+NameId NameTable::Intern(FrameName name){
+    return this->Intern(name.Name(), name.Hash(), true);
+}
+
+void NameTable::Release(uint32_t index){
+    lock_guard<mutex> lock(this->names_mutex);
+    //Intern() may have handed out the name again, or another release may have removed it, since the count reached zero.
+    auto& entry = this->entries[index];
+    if(!entry.used || entry.references.load(memory_order_acquire) > 0)
+        return;
+    auto [first, last] = this->ids.equal_range(entry.hash);
+    for(auto id = first; id != last; id++){
+        if(id->second == index){
+            this->ids.erase(id);
+            break;
+        }
+    }
+    entry.used = false;
+    //Long names do not keep their memory once released.
+    string().swap(entry.name);
+    this->free_entries.push_back(index);
+}
+
+const string& NameTable::Name(const NameId& id) const{
+    if(!id.entry)
+        throw out_of_range("The name handle is empty.");
+    return id.entry->name;
+}
+
+size_t NameTable::Size() const{
+    lock_guard<mutex> lock(this->names_mutex);
+    return this->entries.size() - this->free_entries.size();
+}
+
+//The tables are never destroyed, such that the handles held by static objects can be released at exit in any order.
+NameTable& NameTable::Frames(){
+    static NameTable* table = new NameTable(true);
+    return *table;
+}
+
+NameTable& NameTable::Worlds(){
+    static NameTable* table = new NameTable(false);
+    return *table;
+}
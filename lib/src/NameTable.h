@@ -0,0 +1,214 @@
+#pragma once
+
+//Forward declaration
+class NameTable;
+class NameId;
+class FrameName;
+struct NameEntry;
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+using namespace std;
+
+/**
+ * @brief Handle of a name stored in a NameTable, which keeps the name in the table as long as a copy of the handle exists.
+ *
+ * Copying a handle increments a counter, without locking the table nor allocating memory.
+ */
+class NameId
+{
+    friend class NameTable;
+    private:
+        /// Table holding the name, nullptr for an empty handle.
+        NameTable* table;
+        /// Name and counter of handles, whose address stays valid while the handle exists.
+        NameEntry* entry;
+        /// Index of the entry in the table, which orders the handles.
+        uint32_t index;
+        /**
+         * @brief Take over a reference already counted by the table.
+         */
+        NameId(NameTable* table, NameEntry* entry, uint32_t index);
+        /**
+         * @brief Release the reference held by this handle, if any.
+         */
+        void Release();
+    public:
+        /**
+         * @brief Empty handle, which does not refer to any name.
+         */
+        NameId();
+        NameId(const NameId& other);
+        NameId(NameId&& other) noexcept;
+        NameId& operator=(const NameId& other);
+        NameId& operator=(NameId&& other) noexcept;
+        ~NameId();
+        bool operator==(const NameId& other) const { return this->entry == other.entry; }
+        bool operator!=(const NameId& other) const { return this->entry != other.entry; }
+        bool operator<(const NameId& other) const { return this->index < other.index; }
+};
+
+/**
+ * @brief Name stored in a NameTable, along with the number of handles referring to it. For internal use only.
+ */
+struct NameEntry{
+    /// The name, empty once the entry is free.
+    string name;
+    /// Hash of the name, see HashName().
+    uint64_t hash = 0;
+    /// Number of handles referring to the entry.
+    atomic<uint32_t> references{0};
+    /// Whether the entry holds a name, false once it was released and until it is reused.
+    bool used = false;
+};
+
+/**
+ * @brief Check that a name only contains the characters allowed in frame and world names: [a-z], [0-9] and dash (-).
+ *
+ * @note Usable at compile time, see FrameName.
+ *
+ * @param name: Name to check.
+ * @return bool True if the name is not empty and only contains allowed characters.
+ */
+constexpr bool VerifyInput(string_view name){
+    //Equivalent to matching ^[0-9a-z\-]+$, without building a regular expression or copying the name.
+    if(name.empty())
+        return false;
+    for(char c : name)
+        if(!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-'))
+            return false;
+    return true;
+}
+
+/**
+ * @brief 64-bit FNV-1a hash of a name, usable at compile time, under which the name is stored in a NameTable.
+ */
+constexpr uint64_t HashName(string_view name){
+    uint64_t hash = 14695981039346656037ull;
+    for(char c : name){
+        hash ^= uint8_t(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//The literal is a template over its characters, an extension of GCC and Clang, such that the name can be checked by a static_assert.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+    #pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+/**
+ * @brief Name of a frame validated at compile time, along with its hash. Created with the _frame literal.
+ *
+ * Get(), Set(), Wrt() and Ei() accept it in place of a string, in which case the name is neither checked nor hashed at
+ * runtime, and a name with invalid characters fails the build.
+ *
+ * Example:
+ *
+ *     Eigen::Matrix4d pose = wrt.In("lab").Get("gripper"_frame).Wrt("table"_frame).Ei("table"_frame);
+ */
+class FrameName
+{
+    private:
+        /// Name of the frame, pointing to storage that lives as long as the process.
+        string_view name;
+        /// Hash of the name, see HashName().
+        uint64_t hash;
+        constexpr FrameName(string_view name, uint64_t hash): name(name), hash(hash){}
+        //Only the literal creates names, once they are validated.
+        template<typename CharT, CharT... chars>
+        friend constexpr FrameName operator""_frame();
+    public:
+        /// Name of the frame.
+        constexpr string_view Name() const { return this->name; }
+        /// Hash of the name, see HashName().
+        constexpr uint64_t Hash() const { return this->hash; }
+};
+
+/// Characters of a _frame literal, with a static storage duration. For internal use only.
+template<char... chars>
+inline constexpr char frame_literal[] = {chars..., '\0'};
+
+/**
+ * @brief Frame name literal, e.g. "gripper"_frame, which fails to compile if the name contains invalid characters.
+ */
+template<typename CharT, CharT... chars>
+constexpr FrameName operator""_frame(){
+    static_assert(is_same_v<CharT, char>, "Frame names are narrow strings.");
+    constexpr string_view name(frame_literal<chars...>, sizeof...(chars));
+    static_assert(VerifyInput(name), "Only [a-z], [0-9] and dash (-) is allowed in the frame name.");
+    return FrameName(name, HashName(name));
+}
+#pragma GCC diagnostic pop
+
+/**
+ * @brief Set of names each stored once and identified by a NameId. For internal use only.
+ *
+ * The queries carry the NameId of the world and of the frames instead of copies of their names, such that building a
+ * query such as In("world").Get("frame").Wrt("reference_frame").Ei("expressed_in_frame") does not allocate memory
+ * while the names are held by other queries, such as the compiled queries cached by a GetSet object.
+ *
+ * A name is removed once the last handle referring to it is destroyed and its entry is reused by the next new name,
+ * such that the table only holds the names of the queries that exist, whatever the number of distinct names used.
+ */
+class NameTable
+{
+    private:
+        /// Protects ids, entries and free_entries.
+        mutable mutex names_mutex;
+        /// Indices of the entries indexed by the hash of their name, see HashName().
+        unordered_multimap<uint64_t, uint32_t> ids;
+        /// Names indexed by handle, whose addresses stay valid when names are added.
+        deque<NameEntry> entries;
+        /// Indices of the entries whose name was released, reused before adding entries.
+        vector<uint32_t> free_entries;
+        /// True if the names must be valid frame names, see VerifyInput().
+        bool frame_names;
+        NameTable(bool frame_names);
+        /**
+         * @brief Get the handle of a name from its hash, adding the name to the table if needed.
+         *
+         * @param validated: True if the name is known to be valid, such that it is not checked again.
+         */
+        NameId Intern(string_view name, uint64_t hash, bool validated);
+        /**
+         * @brief Remove the name of an entry if no handle refers to it anymore.
+         */
+        void Release(uint32_t index);
+        friend class NameId;
+    public:
+        /**
+         * @brief Get the handle of a name, adding the name to the table if needed.
+         *
+         * @throw runtime_error: If the table holds frame names and the name contains invalid characters.
+         */
+        NameId Intern(string_view name);
+        /**
+         * @brief Same as above for a name validated and hashed at compile time.
+         */
+        NameId Intern(FrameName name);
+        /**
+         * @brief Get the name of a handle returned by Intern(), valid as long as the handle exists.
+         */
+        const string& Name(const NameId& id) const;
+        /**
+         * @brief Number of names currently held by handles.
+         */
+        size_t Size() const;
+        /**
+         * @brief Table of the frame names, which must only contain the characters allowed by VerifyInput().
+         */
+        static NameTable& Frames();
+        /**
+         * @brief Table of the paths to the databases of the worlds.
+         */
+        static NameTable& Worlds();
+};
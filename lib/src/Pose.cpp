@@ -0,0 +1,65 @@
+#include "Pose.h"
+#include <cstring>
+#include <string>
+using namespace std;
+
+template<> Eigen::Matrix4d ConvertPose(const Eigen::Matrix4d& pose){
+    return pose;
+}
+
+template<> Eigen::Matrix4f ConvertPose(const Eigen::Matrix4d& pose){
+    return pose.cast<float>();
+}
+
+template<> Eigen::Isometry3d ConvertPose(const Eigen::Matrix4d& pose){
+    //The matrix is copied as is, without extracting the rotation again.
+    Eigen::Isometry3d isometry;
+    isometry.matrix() = pose;
+    return isometry;
+}
+
+template<> Eigen::Isometry3f ConvertPose(const Eigen::Matrix4d& pose){
+    Eigen::Isometry3f isometry;
+    isometry.matrix() = pose.cast<float>();
+    return isometry;
+}
+
+template<> PoseQuaternion ConvertPose(const Eigen::Matrix4d& pose){
+    //The upper left block is a rotation matrix, such that it is converted directly rather than through a polar decomposition.
+    Eigen::Quaterniond rotation(Eigen::Matrix3d(pose.topLeftCorner<3,3>()));
+    return {rotation.normalized(), pose.topRightCorner<3,1>()};
+}
+
+template<> PoseArray ConvertPose(const Eigen::Matrix4d& pose){
+    auto [q, t] = ConvertPose<PoseQuaternion>(pose);
+    return {t.x(), t.y(), t.z(), q.x(), q.y(), q.z(), q.w()};
+}
+
+array<float, 12> PackPose(const SE3& pose){
+    array<float, 12> packed;
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+            packed[3*i + j] = pose.rotation(i,j);
+    for(int i = 0; i < 3; i++)
+        packed[9 + i] = pose.translation(i);
+    return packed;
+}
+
+SE3 UnpackPose(const void* packed, int size){
+    if(size != PACKED_POSE_SIZE)
+        throw runtime_error("A pose stored in single precision must have "+to_string(PACKED_POSE_SIZE)+" bytes, not "+to_string(size)+".");
+    //The blob is not guaranteed to be aligned for floats.
+    float values[12];
+    memcpy(values, packed, PACKED_POSE_SIZE);
+    Eigen::Matrix3d rotation;
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+            rotation(i,j) = values[3*i + j];
+    //The rotation widened from floats is only orthonormal to the precision of a float. It is projected back onto a rotation
+    // in double precision, such that a pose returned by Get() can be given to Set() under the strict validation policy.
+    SE3 pose;
+    pose.rotation = Eigen::Quaterniond(rotation).normalized().toRotationMatrix();
+    for(int i = 0; i < 3; i++)
+        pose.translation(i) = values[9 + i];
+    return pose;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Eigen/Eigen>
+#include <Eigen/Geometry>
+#include <array>
+#include <utility>
+#include <stdexcept>
+#include "SE3.h"
+using namespace std;
+
+/**
+ * @brief Pose as a position followed by a unit quaternion: [x, y, z, qx, qy, qz, qw], as in the messages of ROS.
+ */
+typedef array<double, 7> PoseArray;
+
+/**
+ * @brief Pose as a unit quaternion giving the orientation and a vector giving the position.
+ */
+typedef pair<Eigen::Quaterniond, Eigen::Vector3d> PoseQuaternion;
+
+/**
+ * @brief Convert a homogeneous transformation matrix, as returned by the Get() queries, to another representation of the pose.
+ *
+ * The supported representations are Eigen::Matrix4d, Eigen::Matrix4f, Eigen::Isometry3d, Eigen::Isometry3f, PoseQuaternion
+ * and PoseArray. The rotation part of the matrix is assumed to be a rotation matrix, as it is for every pose stored in a world.
+ *
+ * @param pose: Homogeneous transformation matrix.
+ * @return Pose The same pose in the requested representation.
+ */
+template<typename Pose>
+Pose ConvertPose(const Eigen::Matrix4d& pose);
+
+template<> Eigen::Matrix4d ConvertPose(const Eigen::Matrix4d& pose);
+template<> Eigen::Matrix4f ConvertPose(const Eigen::Matrix4d& pose);
+template<> Eigen::Isometry3d ConvertPose(const Eigen::Matrix4d& pose);
+template<> Eigen::Isometry3f ConvertPose(const Eigen::Matrix4d& pose);
+template<> PoseQuaternion ConvertPose(const Eigen::Matrix4d& pose);
+template<> PoseArray ConvertPose(const Eigen::Matrix4d& pose);
+
+/**
+ * @brief Size in bytes of a pose stored in single precision: the rotation matrix row by row followed by the translation, as 12 floats.
+ */
+constexpr int PACKED_POSE_SIZE = 12 * sizeof(float);
+
+/**
+ * @brief Pack a pose in single precision, as stored by the worlds created with DbConnector::SINGLE_PRECISION.
+ *
+ * @note The floats are in the byte order of the host.
+ *
+ * @param pose: Pose to pack.
+ * @return array<float, 12> R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2.
+ */
+array<float, 12> PackPose(const SE3& pose);
+
+/**
+ * @brief Unpack a pose packed by PackPose(), with its rotation orthonormalized in double precision.
+ *
+ * @param packed: Bytes of the packed pose.
+ * @param size: Number of bytes, which must be PACKED_POSE_SIZE.
+ *
+ * @throw runtime_error: If the size is wrong.
+ */
+SE3 UnpackPose(const void* packed, int size);
@@ -0,0 +1,115 @@
+#pragma once
+
+//Forward declaration
+template<typename Rotation> class RigidTransform;
+
+#include <Eigen/Eigen>
+#include <Eigen/Geometry>
+using namespace std;
+
+/**
+ * @brief Rigid transformation made of a rotation and a translation, as used to compose and re-express the poses of the frames.
+ *
+ * Unlike Eigen::Affine3d, the linear part is known to be a rotation, such that the inverse is a transpose rather than a
+ * general matrix inverse, and neither the composition nor the inverse touch the last row of a homogeneous matrix.
+ * The methods are defined in this header such that they are inlined in the loops walking up the tree of frames.
+ *
+ * @tparam Rotation: Eigen::Matrix3d, see SE3, or Eigen::Quaterniond, see SE3Quaternion.
+ */
+template<typename Rotation>
+class RigidTransform
+{
+    public:
+        /// Orientation of the frame relative to its reference frame.
+        Rotation rotation;
+        /// Position of the origin of the frame relative to its reference frame.
+        Eigen::Vector3d translation;
+        /**
+         * @brief Uninitialized transformation, like the Eigen types.
+         */
+        RigidTransform(){}
+        RigidTransform(const Rotation& rotation, const Eigen::Vector3d& translation): rotation(rotation), translation(translation){}
+        /**
+         * @brief Convert a transformation using another representation of the rotation.
+         */
+        template<typename OtherRotation>
+        explicit RigidTransform(const RigidTransform<OtherRotation>& other): rotation(Rotation(other.rotation)), translation(other.translation){}
+        /**
+         * @brief Build a transformation from a homogeneous matrix whose upper left block is a rotation matrix.
+         */
+        explicit RigidTransform(const Eigen::Matrix4d& matrix):
+            rotation(Rotation(Eigen::Matrix3d(matrix.topLeftCorner<3,3>()))),
+            translation(matrix.topRightCorner<3,1>()){}
+        /**
+         * @brief Transformation leaving every point where it is.
+         */
+        static RigidTransform Identity(){
+            return RigidTransform(Rotation::Identity(), Eigen::Vector3d::Zero());
+        }
+        /**
+         * @brief Inverse transformation, computed with the transpose or conjugate of the rotation.
+         */
+        RigidTransform Inverse() const{
+            Rotation inverse = InverseRotation(this->rotation);
+            return RigidTransform(inverse, -(inverse * this->translation));
+        }
+        /**
+         * @brief Composition, such that X_A_C = X_B_C * X_A_B.
+         */
+        RigidTransform operator*(const RigidTransform& other) const{
+            return RigidTransform(this->rotation * other.rotation, this->rotation * other.translation + this->translation);
+        }
+        /**
+         * @brief Transform a point.
+         */
+        Eigen::Vector3d operator*(const Eigen::Vector3d& point) const{
+            return this->rotation * point + this->translation;
+        }
+        /**
+         * @brief Same transformation with its translation expressed in another coordinate system.
+         *
+         * The rotation is unchanged, as a rotation is not expressed in a coordinate system.
+         *
+         * @param R_A_B: Rotation from the coordinate system of the translation to the new one.
+         */
+        RigidTransform Reexpressed(const Rotation& R_A_B) const{
+            return RigidTransform(this->rotation, R_A_B * this->translation);
+        }
+        /**
+         * @brief Rotation as a matrix.
+         */
+        Eigen::Matrix3d RotationMatrix() const{
+            return Eigen::Matrix3d(this->rotation);
+        }
+        /**
+         * @brief Homogeneous 4x4 transformation matrix.
+         */
+        Eigen::Matrix4d Matrix() const{
+            Eigen::Matrix4d matrix = Eigen::Matrix4d::Identity();
+            matrix.topLeftCorner<3,3>() = this->RotationMatrix();
+            matrix.topRightCorner<3,1>() = this->translation;
+            return matrix;
+        }
+    private:
+        static Eigen::Matrix3d InverseRotation(const Eigen::Matrix3d& rotation){ return rotation.transpose(); }
+        static Eigen::Quaterniond InverseRotation(const Eigen::Quaterniond& rotation){ return rotation.conjugate(); }
+};
+
+/**
+ * @brief Rigid transformation with a rotation matrix, cheapest to compose and to apply to points.
+ */
+typedef RigidTransform<Eigen::Matrix3d> SE3;
+
+/**
+ * @brief Rigid transformation with a unit quaternion, used to interpolate orientations.
+ */
+typedef RigidTransform<Eigen::Quaterniond> SE3Quaternion;
+
+/**
+ * @brief Interpolate between two transformations, with a SLERP for the rotation and linearly for the translation.
+ *
+ * @param alpha: 0 for the first transformation, 1 for the second one.
+ */
+inline SE3Quaternion Interpolate(const SE3Quaternion& first, const SE3Quaternion& second, double alpha){
+    return SE3Quaternion(first.rotation.slerp(alpha, second.rotation), (1 - alpha) * first.translation + alpha * second.translation);
+}
@@ -0,0 +1,310 @@
+#include "Snapshot.h"
+#include "DbConnector.h"
+#include "Pose.h"
+#include <sqlite3.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+/// Layout of the header of a snapshot file.
+struct SnapshotHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t frame_count;
+    uint64_t name_count;
+    uint64_t names_size;
+    uint64_t checksum;
+    uint8_t padding[16];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "The snapshot header must be 64 bytes long.");
+
+//64-bit FNV-1a hash, processing eight bytes at a time.
+uint64_t SnapshotChecksum(const uint8_t* data, size_t size){
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for(; i < size; i++)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+//Write the whole buffer, as write() can write fewer bytes than asked.
+static bool WriteAll(int fd, const char* data, size_t size){
+    while(size > 0){
+        ssize_t written = write(fd, data, size);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+//Flush the entries of the directory containing a file, such that creating or renaming the file survives a crash.
+static bool SyncDirectory(const string& path){
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+Snapshot::Snapshot(string path){
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw runtime_error("Cannot open the snapshot "+path+": "+strerror(errno));
+    struct stat info;
+    if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(SnapshotHeader)){
+        close(fd);
+        throw runtime_error("The file "+path+" is not a snapshot.");
+    }
+    this->size = info.st_size;
+    void* mapping = mmap(NULL, this->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        throw runtime_error("Cannot map the snapshot "+path+": "+strerror(errno));
+    this->data = (const uint8_t*)mapping;
+
+    try{
+        SnapshotHeader header;
+        memcpy(&header, this->data, sizeof(header));
+        if(memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+            throw runtime_error("The file "+path+" is not a snapshot.");
+        if(header.version != SNAPSHOT_VERSION)
+            throw runtime_error("The snapshot "+path+" has version "+to_string(header.version)+" but only version "+to_string(SNAPSHOT_VERSION)+" is supported.");
+        this->frame_count = header.frame_count;
+        this->name_count = header.name_count;
+        //Check the sizes before computing any offset from them.
+        if(this->frame_count > this->name_count || this->name_count > UINT32_MAX || header.names_size > UINT32_MAX)
+            throw runtime_error("The snapshot "+path+" is corrupted.");
+        size_t poses_offset = sizeof(SnapshotHeader);
+        size_t parents_offset = poses_offset + this->frame_count * 12 * sizeof(double);
+        size_t name_offsets_offset = parents_offset + this->frame_count * sizeof(int32_t);
+        size_t names_offset = name_offsets_offset + (this->name_count + 1) * sizeof(uint32_t);
+        if(names_offset + header.names_size != this->size)
+            throw runtime_error("The snapshot "+path+" is truncated or corrupted.");
+        if(SnapshotChecksum(this->data + sizeof(SnapshotHeader), this->size - sizeof(SnapshotHeader)) != header.checksum)
+            throw runtime_error("The checksum of the snapshot "+path+" does not match its content.");
+        this->poses = (const double*)(this->data + poses_offset);
+        this->parents = (const int32_t*)(this->data + parents_offset);
+        this->name_offsets = (const uint32_t*)(this->data + name_offsets_offset);
+        this->names = (const char*)(this->data + names_offset);
+        //Make sure that no index or offset points outside of the file.
+        for(size_t i = 0; i < this->frame_count; i++){
+            if(this->parents[i] < -1 || this->parents[i] >= (int64_t)this->name_count)
+                throw runtime_error("The snapshot "+path+" is corrupted.");
+        }
+        for(size_t i = 0; i < this->name_count; i++){
+            if(this->name_offsets[i] > this->name_offsets[i+1])
+                throw runtime_error("The snapshot "+path+" is corrupted.");
+        }
+        if(this->name_offsets[this->name_count] != header.names_size)
+            throw runtime_error("The snapshot "+path+" is corrupted.");
+    }catch(const std::runtime_error& err){
+        munmap((void*)this->data, this->size);
+        throw;
+    }
+}
+
+Snapshot::~Snapshot(){
+    munmap((void*)this->data, this->size);
+}
+
+string_view Snapshot::NameAt(size_t index) const{
+    return string_view(this->names + this->name_offsets[index], this->name_offsets[index+1] - this->name_offsets[index]);
+}
+
+size_t Snapshot::Size() const{
+    return this->frame_count;
+}
+
+string_view Snapshot::Name(size_t index) const{
+    if(index >= this->frame_count)
+        throw out_of_range("There are only "+to_string(this->frame_count)+" frames in the snapshot.");
+    return this->NameAt(index);
+}
+
+string_view Snapshot::Parent(size_t index) const{
+    if(index >= this->frame_count)
+        throw out_of_range("There are only "+to_string(this->frame_count)+" frames in the snapshot.");
+    if(this->parents[index] < 0)
+        return string_view();
+    return this->NameAt(this->parents[index]);
+}
+
+Eigen::Matrix4d Snapshot::Pose(size_t index) const{
+    if(index >= this->frame_count)
+        throw out_of_range("There are only "+to_string(this->frame_count)+" frames in the snapshot.");
+    const double* p = this->poses + 12 * index;
+    Eigen::Matrix4d pose;
+    pose << p[0], p[1], p[2], p[9],
+            p[3], p[4], p[5], p[10],
+            p[6], p[7], p[8], p[11],
+            0, 0, 0, 1;
+    return pose;
+}
+
+size_t Snapshot::Find(string_view name) const{
+    //The names of the frames are sorted.
+    size_t low = 0;
+    size_t high = this->frame_count;
+    while(low < high){
+        size_t middle = low + (high - low) / 2;
+        if(this->NameAt(middle) < name)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if(low == this->frame_count || this->NameAt(low) != name)
+        throw runtime_error("The reference frame "+string(name)+" does not exist in the snapshot.");
+    return low;
+}
+
+void Snapshot::LoadInto(SQLite::Database& db) const{
+    //Take the write lock right away, readers keep seeing the previous content until the commit. Within a transaction
+    // of the caller, a savepoint undoes a partial load without ending that transaction.
+    bool own_transaction = sqlite3_get_autocommit(db.getHandle());
+    db.exec(own_transaction ? "BEGIN IMMEDIATE" : "SAVEPOINT load_snapshot");
+    try{
+        db.exec("DELETE FROM frames");
+        //The snapshot is in double precision, whatever the precision of the world it is loaded into.
+        bool single_precision = DbConnector::IsSinglePrecision(db);
+        SQLite::Statement query(db, single_precision ? "INSERT INTO frames VALUES (?, ?, ?)" : "INSERT INTO frames VALUES (?, ?, ?,?,?, ?,?,?, ?,?,?, ?,?,?)");
+        for(size_t i = 0; i < this->frame_count; i++){
+            string_view name = this->NameAt(i);
+            query.reset();
+            query.bind(1, string(name));
+            if(this->parents[i] < 0)
+                query.bind(2);
+            else
+                query.bind(2, string(this->NameAt(this->parents[i])));
+            const double* p = this->poses + 12 * i;
+            if(single_precision){
+                //The snapshot and PackPose() order the values the same way.
+                array<float, 12> packed;
+                for(int j = 0; j < 12; j++)
+                    packed[j] = p[j];
+                query.bind(3, packed.data(), PACKED_POSE_SIZE);
+                query.executeStep();
+                continue;
+            }
+            for(int j = 0; j < 12; j++)
+                query.bind(3 + j, p[j]);
+            query.executeStep();
+        }
+        db.exec(own_transaction ? "COMMIT" : "RELEASE load_snapshot");
+    }catch(...){
+        //Undo what was written, without hiding the original error.
+        try{
+            db.exec(own_transaction ? "ROLLBACK" : "ROLLBACK TO load_snapshot; RELEASE load_snapshot");
+        }catch(...){}
+        throw;
+    }
+}
+
+void Snapshot::Export(SQLite::Database& db, string path){
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+
+    vector<double> poses;
+    vector<string> parent_names;
+    vector<string> names;
+    //The frames are sorted by name to allow binary searches in the snapshot.
+    bool single_precision = DbConnector::IsSinglePrecision(db);
+    SQLite::Statement query(db, single_precision ? "SELECT name, parent, pose FROM frames ORDER BY name" : "SELECT name, parent, R00, R01, R02, R10, R11, R12, R20, R21, R22, t0, t1, t2 FROM frames ORDER BY name");
+    while(query.executeStep()){
+        names.push_back(query.getColumn(0).getText());
+        parent_names.push_back(query.getColumn(1).isNull() ? "" : query.getColumn(1).getText());
+        if(single_precision){
+            auto packed = query.getColumn(2);
+            auto pose = UnpackPose(packed.getBlob(), packed.getBytes());
+            for(int i = 0; i < 3; i++)
+                for(int j = 0; j < 3; j++)
+                    poses.push_back(pose.rotation(i,j));
+            for(int i = 0; i < 3; i++)
+                poses.push_back(pose.translation(i));
+            continue;
+        }
+        for(int j = 0; j < 12; j++)
+            poses.push_back(query.getColumn(2 + j).getDouble());
+    }
+    header.frame_count = names.size();
+
+    //Parents are referred to by the index of their name, adding the names of parents that are not defined.
+    map<string, int32_t> indices;
+    for(size_t i = 0; i < names.size(); i++)
+        indices[names[i]] = i;
+    vector<int32_t> parents;
+    for(auto const& parent_name : parent_names){
+        if(parent_name.empty()){
+            parents.push_back(-1);
+            continue;
+        }
+        auto index = indices.find(parent_name);
+        if(index == indices.end()){
+            index = indices.emplace(parent_name, names.size()).first;
+            names.push_back(parent_name);
+        }
+        parents.push_back(index->second);
+    }
+    header.name_count = names.size();
+
+    vector<uint32_t> name_offsets;
+    string all_names;
+    for(auto const& name : names){
+        name_offsets.push_back(all_names.size());
+        all_names += name;
+    }
+    name_offsets.push_back(all_names.size());
+    header.names_size = all_names.size();
+
+    string payload;
+    payload.append((const char*)poses.data(), poses.size() * sizeof(double));
+    payload.append((const char*)parents.data(), parents.size() * sizeof(int32_t));
+    payload.append((const char*)name_offsets.data(), name_offsets.size() * sizeof(uint32_t));
+    payload.append(all_names);
+    header.checksum = SnapshotChecksum((const uint8_t*)payload.data(), payload.size());
+
+    //Write under a temporary name and rename, which atomically replaces any previous snapshot. The file and its directory
+    // are flushed first, such that a crash leaves either the previous snapshot or the complete new one, never an empty file.
+    string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+        throw runtime_error("Cannot write the snapshot "+path+": "+strerror(errno));
+    bool written = WriteAll(fd, (const char*)&header, sizeof(header)) && WriteAll(fd, payload.data(), payload.size()) && fsync(fd) == 0;
+    int error = errno;
+    if(close(fd) != 0 && written){
+        written = false;
+        error = errno;
+    }
+    if(!written || !SyncDirectory(temporary_path) || rename(temporary_path.c_str(), path.c_str()) != 0){
+        //The error of the write or fsync, if any, is the one that explains the failure.
+        if(written)
+            error = errno;
+        remove(temporary_path.c_str());
+        throw runtime_error("Cannot write the snapshot "+path+": "+strerror(error));
+    }
+    //Make the rename itself durable.
+    SyncDirectory(path);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+//Forward declaration
+class Snapshot;
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <Eigen/Eigen>
+#include <string>
+#include <string_view>
+#include <cstdint>
+using namespace std;
+
+/*
+* Binary snapshot of a world. All integers and reals are in the native (little-endian) byte order.
+*
+* Header (64 bytes):  char[8] magic "WRTSNAP", u32 version, u32 reserved, u64 frame_count, u64 name_count,
+*                     u64 names_size, u64 checksum of everything following the header, 16 reserved bytes.
+* Poses:              frame_count x 12 f64, the rotation matrix in row-major order followed by the translation.
+* Parents:            frame_count x i32, index of the name of the parent frame or -1 for a frame without parent.
+* Name offsets:       (name_count + 1) x u32, offset of each name in the names section, the last one being its size.
+* Names:              names_size bytes holding the concatenated names.
+*
+* The first frame_count names are those of the frames, sorted, and the others are names of parents that are not defined in the world.
+*/
+const char SNAPSHOT_MAGIC[8] = "WRTSNAP";
+const uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * @brief Read-only view of a binary snapshot of a world, mapped in memory.
+ *
+ * Opening a snapshot only maps the file and verifies its checksum, such that even large scenes can be read in
+ * milliseconds. The snapshot can then be inspected directly or loaded into a world with GetSet::Import().
+ *
+ * Example:
+ *
+ *     wrt.In("lab").Export("lab.wrts");
+ *     auto snapshot = Snapshot("lab.wrts");
+ *     Eigen::Matrix4d pose = snapshot.Pose(snapshot.Find("gripper"));
+ */
+class Snapshot
+{
+    private:
+        /// Beginning of the mapped file.
+        const uint8_t* data;
+        /// Size of the mapped file in bytes.
+        size_t size;
+        /// Number of frames defined in the snapshot.
+        size_t frame_count;
+        /// Number of names in the snapshot, including the parents that are not defined.
+        size_t name_count;
+        /// Poses of the frames, 12 doubles per frame.
+        const double* poses;
+        /// Index of the name of the parent of each frame.
+        const int32_t* parents;
+        /// Offset of each name in the names section.
+        const uint32_t* name_offsets;
+        /// Concatenated names.
+        const char* names;
+        /**
+         * @brief Get a name by its index.
+         */
+        string_view NameAt(size_t index) const;
+    public:
+        /**
+         * @brief Map a snapshot file in memory.
+         *
+         * @param path: Path to the snapshot file.
+         *
+         * @throw runtime_error: If the file cannot be read, is not a snapshot, has an unsupported version or is corrupted.
+         */
+        Snapshot(string path);
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        ~Snapshot();
+        /**
+         * @brief Number of frames in the snapshot.
+         */
+        size_t Size() const;
+        /**
+         * @brief Name of the frame at the specified index.
+         */
+        string_view Name(size_t index) const;
+        /**
+         * @brief Name of the parent of the frame at the specified index, empty if the frame has no parent.
+         */
+        string_view Parent(size_t index) const;
+        /**
+         * @brief Pose of the frame at the specified index with respect to its parent and expressed in its parent.
+         */
+        Eigen::Matrix4d Pose(size_t index) const;
+        /**
+         * @brief Find the index of a frame in O(log n).
+         *
+         * @throw runtime_error: If the frame is not in the snapshot.
+         */
+        size_t Find(string_view name) const;
+        /**
+         * @brief Replace the content of a world by the content of the snapshot, in a single transaction, or in a savepoint
+         *  of the transaction already running on the connection.
+         *
+         * @note Other connections see either the previous content of the world or the content of the snapshot.
+         *
+         * @param db: Connection to the database of the world.
+         */
+        void LoadInto(SQLite::Database& db) const;
+        /**
+         * @brief Write a snapshot of a world to a file.
+         *
+         * @note The file is first written under a temporary name and then renamed, such that readers never see a partial snapshot.
+         *
+         * @param db: Connection to the database of the world.
+         * @param path: Path to the snapshot file.
+         *
+         * @throw runtime_error: If the file cannot be written.
+         */
+        static void Export(SQLite::Database& db, string path);
+};
@@ -0,0 +1,128 @@
+#include "Stats.h"
+#include <map>
+#include <mutex>
+#include <sstream>
+using namespace std;
+
+uint64_t Histogram::Quantile(double quantile) const{
+    if(this->count == 0)
+        return 0;
+    uint64_t rank = quantile * this->count;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < this->buckets.size(); i++){
+        seen += this->buckets[i];
+        if(seen > rank)
+            return i == 0 ? 0 : min(this->max, i >= 64 ? UINT64_MAX : (uint64_t(1) << i) - 1);
+    }
+    return this->max;
+}
+
+//Write a histogram as a JSON object, without the empty buckets at the end.
+void WriteHistogram(ostream& out, const Histogram& histogram){
+    size_t used = histogram.buckets.size();
+    while(used > 0 && histogram.buckets[used - 1] == 0)
+        used--;
+    out << "{\"count\": " << histogram.count << ", \"sum\": " << histogram.sum << ", \"max\": " << histogram.max
+        << ", \"p50\": " << histogram.Quantile(0.5) << ", \"p99\": " << histogram.Quantile(0.99) << ", \"buckets\": [";
+    for(size_t i = 0; i < used; i++)
+        out << (i == 0 ? "" : ", ") << histogram.buckets[i];
+    out << "]}";
+}
+
+string WorldStats::ToJson() const{
+    stringstream out;
+    out << "{\"db_opens\": " << this->db_opens << ", \"statements_prepared\": " << this->statements_prepared
+        << ", \"rows_read\": " << this->rows_read << ", \"commits\": " << this->commits
+        << ", \"busy_retries\": " << this->busy_retries << ", \"errors\": " << this->errors << ", \"get_latency_ns\": ";
+    WriteHistogram(out, this->get_latency);
+    out << ", \"set_latency_ns\": ";
+    WriteHistogram(out, this->set_latency);
+    out << ", \"depth\": ";
+    WriteHistogram(out, this->depth);
+    out << "}";
+    return out.str();
+}
+
+AtomicHistogram::AtomicHistogram(): count(0), sum(0), max(0){
+    for(auto& bucket : this->buckets)
+        bucket = 0;
+}
+
+void AtomicHistogram::Record(uint64_t value){
+    //The index of the bucket is the number of significant bits of the value.
+    size_t bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    this->buckets[min(bucket, size_t(63))].fetch_add(1, memory_order_relaxed);
+    this->count.fetch_add(1, memory_order_relaxed);
+    this->sum.fetch_add(value, memory_order_relaxed);
+    uint64_t previous = this->max.load(memory_order_relaxed);
+    while(value > previous && !this->max.compare_exchange_weak(previous, value, memory_order_relaxed));
+}
+
+Histogram AtomicHistogram::Read() const{
+    Histogram histogram;
+    for(auto const& bucket : this->buckets)
+        histogram.buckets.push_back(bucket.load(memory_order_relaxed));
+    histogram.count = this->count.load(memory_order_relaxed);
+    histogram.sum = this->sum.load(memory_order_relaxed);
+    histogram.max = this->max.load(memory_order_relaxed);
+    return histogram;
+}
+
+StatsCollector::StatsCollector(): db_opens(0), statements_prepared(0), rows_read(0), commits(0), busy_retries(0), errors(0){}
+
+//Collectors of the worlds whose statistics are collected, indexed by the path to their database.
+static mutex collectors_mutex;
+static map<string, shared_ptr<StatsCollector>> collectors;
+//Number of collectors, read without taking the mutex such that looking up a collector is free when there are none.
+static atomic<size_t> collectors_count(0);
+
+shared_ptr<StatsCollector> StatsCollector::Register(const string& world_path){
+    lock_guard<mutex> lock(collectors_mutex);
+    auto& collector = collectors[world_path];
+    if(!collector){
+        collector = make_shared<StatsCollector>();
+        collectors_count = collectors.size();
+    }
+    return collector;
+}
+
+shared_ptr<StatsCollector> StatsCollector::Find(const string& world_path){
+    if(collectors_count.load(memory_order_relaxed) == 0)
+        return nullptr;
+    lock_guard<mutex> lock(collectors_mutex);
+    auto collector = collectors.find(world_path);
+    return collector == collectors.end() ? nullptr : collector->second;
+}
+
+WorldStats StatsCollector::Read() const{
+    WorldStats stats;
+    stats.db_opens = this->db_opens;
+    stats.statements_prepared = this->statements_prepared;
+    stats.rows_read = this->rows_read;
+    stats.commits = this->commits;
+    stats.busy_retries = this->busy_retries;
+    stats.errors = this->errors;
+    stats.get_latency = this->get_latency.Read();
+    stats.set_latency = this->set_latency.Read();
+    stats.depth = this->depth.Read();
+    return stats;
+}
+
+OperationTimer::OperationTimer(StatsCollector* stats, bool is_get): stats(stats), histogram(nullptr){
+    if(this->stats){
+        this->histogram = is_get ? &this->stats->get_latency : &this->stats->set_latency;
+        this->start = chrono::steady_clock::now();
+    }
+}
+
+OperationTimer::~OperationTimer(){
+    if(this->histogram)
+        this->stats->errors++;
+}
+
+void OperationTimer::Done(){
+    if(this->histogram){
+        this->histogram->Record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - this->start).count());
+        this->histogram = nullptr;
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+//Forward declaration
+class StatsCollector;
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+using namespace std;
+
+/**
+ * @brief Distribution of values in buckets whose bounds are powers of two: bucket 0 counts the zeros and bucket i
+ *  counts the values in [2^(i-1), 2^i).
+ */
+struct Histogram{
+    /// Number of values in each bucket.
+    vector<uint64_t> buckets;
+    /// Number of values recorded.
+    uint64_t count = 0;
+    /// Sum of the values recorded.
+    uint64_t sum = 0;
+    /// Largest value recorded.
+    uint64_t max = 0;
+    /**
+     * @brief Approximate the specified quantile by the upper bound of the bucket holding it.
+     *
+     * @param quantile: Number between 0 and 1, e.g. 0.99 for the 99th percentile.
+     * @return uint64_t Upper bound of the bucket, never more than the largest value recorded, or 0 if there is no value.
+     */
+    uint64_t Quantile(double quantile) const;
+};
+
+/**
+ * @brief Counters and histograms describing the accesses made by this process to a world, see DbConnector::COLLECT_STATS.
+ *
+ * The latencies are in nanoseconds and include the time spent waiting for the locks held by other connections.
+ */
+struct WorldStats{
+    /// Number of connections opened to the database for the queries.
+    uint64_t db_opens = 0;
+    /// Number of SQL statements prepared, by the compiled queries and thus by each Get() and Set().
+    uint64_t statements_prepared = 0;
+    /// Number of rows read from the database by the Get() and Set() operations.
+    uint64_t rows_read = 0;
+    /// Number of transactions committed by the Set() operations and by the BulkWriter.
+    uint64_t commits = 0;
+    /// Number of times another connection held a lock needed by this process, which made it wait and retry.
+    uint64_t busy_retries = 0;
+    /// Number of Get() and Set() operations that failed.
+    uint64_t errors = 0;
+    /// Latency of the Get() operations, in nanoseconds.
+    Histogram get_latency;
+    /// Latency of the Set() operations, in nanoseconds.
+    Histogram set_latency;
+    /// Number of frames walked from a frame to the root of its tree, for each pose composed by a Get().
+    Histogram depth;
+    /**
+     * @brief Serialize the statistics as a JSON object, for monitoring systems.
+     */
+    string ToJson() const;
+};
+
+/**
+ * @brief Histogram updated concurrently by many threads. For internal use only.
+ */
+class AtomicHistogram{
+    private:
+        atomic<uint64_t> buckets[64];
+        atomic<uint64_t> count;
+        atomic<uint64_t> sum;
+        atomic<uint64_t> max;
+    public:
+        AtomicHistogram();
+        void Record(uint64_t value);
+        Histogram Read() const;
+};
+
+/**
+ * @brief Collects the statistics of a world for the whole process. For internal use only, see GetSet::Stats().
+ *
+ * A single collector exists per world, shared by all the connectors, connections and queries of the process.
+ * When no world collects statistics, looking up a collector costs a single atomic read.
+ */
+class StatsCollector{
+    public:
+        atomic<uint64_t> db_opens;
+        atomic<uint64_t> statements_prepared;
+        atomic<uint64_t> rows_read;
+        atomic<uint64_t> commits;
+        atomic<uint64_t> busy_retries;
+        atomic<uint64_t> errors;
+        AtomicHistogram get_latency;
+        AtomicHistogram set_latency;
+        AtomicHistogram depth;
+        StatsCollector();
+        /**
+         * @brief Start collecting the statistics of a world, if not already done.
+         *
+         * @param world_path: Path to the database of the world, without the .db extension.
+         */
+        static shared_ptr<StatsCollector> Register(const string& world_path);
+        /**
+         * @brief Get the collector of a world.
+         *
+         * @return shared_ptr<StatsCollector> Collector of the world, or nullptr if its statistics are not collected.
+         */
+        static shared_ptr<StatsCollector> Find(const string& world_path);
+        /**
+         * @brief Copy the current values of the statistics.
+         */
+        WorldStats Read() const;
+};
+
+/**
+ * @brief Measures the latency of an operation if the statistics are collected. For internal use only.
+ *
+ * The operation is counted as an error if the timer is destroyed before Done() is called, such as when an exception is thrown.
+ */
+class OperationTimer{
+    private:
+        StatsCollector* stats;
+        AtomicHistogram* histogram;
+        chrono::steady_clock::time_point start;
+    public:
+        OperationTimer(StatsCollector* stats, bool is_get);
+        ~OperationTimer();
+        /// Record the latency of the operation, which succeeded.
+        void Done();
+};
@@ -0,0 +1,23 @@
+#include "Trace.h"
+using namespace std;
+
+atomic<TraceCallback> trace_callback(nullptr);
+
+void SetTraceCallback(TraceCallback callback){
+    trace_callback = callback;
+}
+
+const char* TracePointName(TracePoint point){
+    switch(point){
+        case TracePoint::db_open:   return "db_open";
+        case TracePoint::prepare:   return "prepare";
+        case TracePoint::step:      return "step";
+        case TracePoint::begin:     return "begin";
+        case TracePoint::commit:    return "commit";
+        case TracePoint::get_enter: return "get_enter";
+        case TracePoint::get_exit:  return "get_exit";
+        case TracePoint::set_enter: return "set_enter";
+        case TracePoint::set_exit:  return "set_exit";
+    }
+    return "unknown";
+}
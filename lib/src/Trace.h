@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+using namespace std;
+
+/**
+ * @brief Points of the library at which a trace event is emitted, see SetTraceCallback().
+ *
+ * Each point is also a static probe of the *wrt* provider, with the same name, usable with perf or bpftrace
+ * when the library is built with WRT_TRACING and sys/sdt.h is available. The three arguments of the probes are the
+ * fields of TraceEvent: world path, detail and value.
+ *
+ * Example: Distribution of the time spent in each Get by the command-line interface, in microseconds.
+ *
+ *     bpftrace -e 'usdt:/usr/local/bin/WRT:wrt:get_enter { @start[tid] = nsecs; }
+ *                  usdt:/usr/local/bin/WRT:wrt:get_exit /@start[tid]/ { @us = hist((nsecs - @start[tid]) / 1000); delete(@start[tid]); }'
+ */
+enum class TracePoint{
+    /// A connection to the database of a world was opened. Detail: empty.
+    db_open,
+    /// A statement was prepared. Detail: SQL text.
+    prepare,
+    /// A statement was executed for one step, including the time spent waiting for locks. Detail: SQL text. Value: 1 if a row was returned.
+    step,
+    /// A transaction was started. Detail: kind of transaction.
+    begin,
+    /// A transaction was committed. Detail: kind of transaction.
+    commit,
+    /// A Get operation started. Detail: name of the subject frame.
+    get_enter,
+    /// A Get operation ended. Detail: name of the subject frame. Value: 1 if it failed.
+    get_exit,
+    /// A Set operation started. Detail: name of the subject frame.
+    set_enter,
+    /// A Set operation ended. Detail: name of the subject frame. Value: 1 if it failed.
+    set_exit
+};
+
+/**
+ * @brief Event passed to the trace callback. The strings are only valid during the call.
+ */
+struct TraceEvent{
+    /// Point of the library that emitted the event.
+    TracePoint point;
+    /// Path to the database of the world, with or without the .db extension.
+    const char* world;
+    /// Description of the event, which depends on the point.
+    const char* detail;
+    /// Value attached to the event, which depends on the point.
+    int64_t value;
+};
+
+/**
+ * @brief Function called synchronously, by the thread performing the operation, for every trace event.
+ */
+typedef void (*TraceCallback)(const TraceEvent& event);
+
+/**
+ * @brief Call the specified function for every trace event of the process, replacing any previous callback.
+ *
+ * @note Events are only emitted if the library was built with WRT_TRACING, which is the default. The callback must be
+ *  thread-safe and fast, as it runs on the hot path of the queries.
+ *
+ * @param callback: Function to call, or nullptr to stop tracing.
+ */
+void SetTraceCallback(TraceCallback callback);
+
+/**
+ * @brief Name of a trace point, which is also the name of its static probe.
+ */
+const char* TracePointName(TracePoint point);
+
+/// Callback set by SetTraceCallback(). For internal use only.
+extern atomic<TraceCallback> trace_callback;
+
+/*
+* WRT_TRACE(point, world, detail, value) emits a trace event: it fires the static probe of the point, which is a
+* no-op unless a tracer is attached, and calls the trace callback if one is set. The arguments may be evaluated twice
+* and must not have side effects. Without WRT_TRACING, it compiles to nothing.
+*/
+#ifdef WRT_TRACING
+    #ifdef WRT_HAVE_SDT
+        #include <sys/sdt.h>
+        #define WRT_PROBE(point, world, detail, value) STAP_PROBE3(wrt, point, world, detail, value)
+    #else
+        #define WRT_PROBE(point, world, detail, value)
+    #endif
+    #define WRT_TRACE(point, world, detail, value) do{ \
+            WRT_PROBE(point, world, detail, int64_t(value)); \
+            if(TraceCallback wrt_callback = trace_callback.load(memory_order_relaxed)) \
+                wrt_callback(TraceEvent{TracePoint::point, (world), (detail), int64_t(value)}); \
+        }while(0)
+#else
+    #define WRT_TRACE(point, world, detail, value) do{}while(0)
+#endif
@@ -0,0 +1,83 @@
+#include "WorldTransaction.h"
+#include "Busy.h"
+#include "Trace.h"
+#include <sqlite3.h>
+using namespace std;
+
+WorldTransaction::WorldTransaction(string world_name, shared_ptr<SQLite::Database> db, bool read_only):
+    world_name(world_name), db(db), read_only(read_only), active(false){
+    if(!sqlite3_get_autocommit(this->db->getHandle()))
+        throw runtime_error("A transaction is already running on the connection to the world "+this->world_name+".");
+    this->stats = StatsCollector::Find(this->world_name);
+
+    try{
+        if(this->read_only){
+            //A deferred transaction only takes its snapshot at the first read, which is done right away such that
+            // the Gets see the world as it was when the transaction started. Writing is refused until it ends.
+            this->db->exec("BEGIN");
+            this->db->exec("PRAGMA query_only = 1");
+            this->db->exec("SELECT count(*) FROM sqlite_master");
+        }else{
+            //The write lock is taken right away, such that the Sets cannot fail half-way because another
+            // connection wrote after the first Get.
+            this->db->exec("BEGIN IMMEDIATE");
+        }
+    }catch(const SQLite::Exception& err){
+        if(!sqlite3_get_autocommit(this->db->getHandle()))
+            this->End("ROLLBACK");
+        RethrowBusy(err, this->world_name);
+    }
+    this->active = true;
+    WRT_TRACE(begin, this->world_name.c_str(), this->read_only ? "read" : "user", 0);
+}
+
+WorldTransaction::WorldTransaction(WorldTransaction&& other):
+    world_name(move(other.world_name)),
+    db(move(other.db)),
+    stats(move(other.stats)),
+    read_only(other.read_only),
+    active(other.active){
+    other.active = false;
+}
+
+WorldTransaction::~WorldTransaction(){
+    if(this->active){
+        //Destructors must not throw, the connection rolls back by itself when it is closed anyway.
+        try{ this->Rollback(); }catch(...){}
+    }
+}
+
+void WorldTransaction::End(const char* sql){
+    try{
+        this->db->exec(sql);
+    }catch(...){
+        //The connection may be used for writing again only once the transaction is over.
+        if(this->read_only && sqlite3_get_autocommit(this->db->getHandle()))
+            this->db->exec("PRAGMA query_only = 0");
+        throw;
+    }
+    if(this->read_only)
+        this->db->exec("PRAGMA query_only = 0");
+}
+
+void WorldTransaction::Commit(){
+    if(!this->active)
+        throw runtime_error("The transaction on the world "+this->world_name+" was already committed or rolled back.");
+    //A failed commit leaves the transaction active, such that it can be committed again or rolled back.
+    this->End("COMMIT");
+    this->active = false;
+    WRT_TRACE(commit, this->world_name.c_str(), this->read_only ? "read" : "user", 0);
+    if(this->stats && !this->read_only)
+        this->stats->commits++;
+}
+
+void WorldTransaction::Rollback(){
+    if(!this->active)
+        throw runtime_error("The transaction on the world "+this->world_name+" was already committed or rolled back.");
+    this->active = false;
+    this->End("ROLLBACK");
+}
+
+bool WorldTransaction::Active(){
+    return this->active;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+//Forward declaration
+class WorldTransaction;
+
+#include "Stats.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <string>
+#include <memory>
+using namespace std;
+
+/**
+ * @brief Groups the Get() and Set() queries of a world in a single transaction on its connection, see GetSet::Transaction().
+ *
+ * While the object is active, every query started from the GetSet object that created it, or from the queries compiled
+ * from that object, runs in the transaction: the Gets see the same state of the world, which other processes cannot
+ * change, and the Sets are committed together by Commit() or not at all. The transaction is rolled back if the object
+ * is destroyed before being committed, such as when an exception is thrown.
+ *
+ * Example: Moving the gripper relative to its current pose, without any other process moving it in between.
+ *
+ *     auto world = wrt.In("lab");
+ *     auto transaction = world.Transaction();
+ *     Eigen::Matrix4d pose = world.Get("gripper").Wrt("table").Ei("table");
+ *     pose(2,3) += 0.1;
+ *     world.Set("gripper").Wrt("table").Ei("table").As(pose);
+ *     transaction.Commit();
+ */
+class WorldTransaction
+{
+    private:
+        /// Path to the database of the world.
+        string world_name;
+        /// Connection in which the transaction runs.
+        shared_ptr<SQLite::Database> db;
+        /// Statistics of the world, only if they are collected, see DbConnector::COLLECT_STATS.
+        shared_ptr<StatsCollector> stats;
+        /// True if the Sets are refused.
+        bool read_only;
+        /// True until the transaction is committed or rolled back.
+        bool active;
+        /**
+         * @brief End the transaction with the specified statement, restoring the connection even if it fails.
+         */
+        void End(const char* sql);
+    public:
+        /**
+         * @brief Start a transaction on a connection. Do not use this class directly, see GetSet::Transaction().
+         *
+         * @param world_name: Path to the database of the world.
+         * @param db: Connection to the database of the world.
+         * @param read_only: True to only read a snapshot of the world without locking out the writers of other
+         *  processes, false to also write and lock out the other writers until the end of the transaction.
+         *
+         * @throw TimeoutError: If another connection held the write lock for longer than the busy timeout.
+         * @throw runtime_error: If a transaction is already running on the connection.
+         */
+        WorldTransaction(string world_name, shared_ptr<SQLite::Database> db, bool read_only);
+        WorldTransaction(WorldTransaction&& other);
+        WorldTransaction(const WorldTransaction&) = delete;
+        WorldTransaction& operator=(const WorldTransaction&) = delete;
+        /**
+         * @brief Destroy the object, rolling back the transaction if it is still active.
+         */
+        ~WorldTransaction();
+        /**
+         * @brief Commit the Sets performed since the transaction started, making them visible to the other connections.
+         *
+         * @throw runtime_error: If the transaction is not active anymore.
+         */
+        void Commit();
+        /**
+         * @brief Discard the Sets performed since the transaction started.
+         *
+         * @throw runtime_error: If the transaction is not active anymore.
+         */
+        void Rollback();
+        /**
+         * @brief Whether the transaction can still be committed or rolled back.
+         */
+        bool Active();
+};
@@ -1,4 +1,10 @@
 #include "DbConnector.h"
 #include "WrtGetSet.h"
 #include "ExpressedIn.h"
-#include "GetSet.h"
\ No newline at end of file
+#include "GetSet.h"
+#include "Daemon.h"
+#include "BulkWriter.h"
+#include "WorldTransaction.h"
+#include "Snapshot.h"
+#include "History.h"
+#include "Trace.h"
\ No newline at end of file
@@ -1,26 +1,50 @@
 #include "WrtGetSet.h"
 
-WrtGet::WrtGet(string world_name, string subject_name): world_name(world_name), subject_name(subject_name){
+WrtGet::WrtGet(string_view world_name, string_view subject_name, shared_ptr<SQLite::Database> db):
+    WrtGet(NameTable::Worlds().Intern(world_name), NameTable::Frames().Intern(subject_name), db, nullptr){
+
+}
+
+WrtGet::WrtGet(NameId world, NameId subject, shared_ptr<SQLite::Database> db, shared_ptr<CompiledGets> compiled_gets):
+    world(world), subject(subject), db(db), compiled_gets(compiled_gets){
 
 }
 
 WrtGet::~WrtGet(){}
 
-ExpressedInGet WrtGet::Wrt(string basis_name){
-    this->basis_name = basis_name;
-    return ExpressedInGet(this->world_name, this->subject_name, this->basis_name);
+ExpressedInGet WrtGet::Wrt(string_view basis_name){
+    return ExpressedInGet(this->world, this->subject, NameTable::Frames().Intern(basis_name), this->db, this->compiled_gets);
 }
 
+ExpressedInGet WrtGet::Wrt(FrameName basis_name){
+    return ExpressedInGet(this->world, this->subject, NameTable::Frames().Intern(basis_name), this->db, this->compiled_gets);
+}
+
+
+WrtSet::WrtSet(string_view world_name, string_view subject_name, shared_ptr<SQLite::Database> db):
+    WrtSet(NameTable::Worlds().Intern(world_name), NameTable::Frames().Intern(subject_name), db, PoseValidation::Strict){
+    
+}
 
-WrtSet::WrtSet(string world_name, string subject_name): world_name(world_name), subject_name(subject_name){
+WrtSet::WrtSet(NameId world, NameId subject, shared_ptr<SQLite::Database> db, PoseValidation validation):
+    world(world), subject(subject), db(db), validation(validation){
     
 }
 
 WrtSet::~WrtSet(){}
 
-ExpressedInSet WrtSet::Wrt(string basis_name){
-    this->basis_name = basis_name;
-    if(this->subject_name == this->basis_name)
-        throw runtime_error("The reference frame "+this->basis_name+" must be different than the target frame "+this->subject_name+".");
-    return ExpressedInSet(this->world_name, this->subject_name, this->basis_name);
+ExpressedInSet WrtSet::Wrt(string_view basis_name){
+    return this->Wrt(NameTable::Frames().Intern(basis_name));
+}
+
+ExpressedInSet WrtSet::Wrt(FrameName basis_name){
+    return this->Wrt(NameTable::Frames().Intern(basis_name));
+}
+
+ExpressedInSet WrtSet::Wrt(NameId basis){
+    if(this->subject == basis){
+        auto& basis_name = NameTable::Frames().Name(basis);
+        throw runtime_error("The reference frame "+basis_name+" must be different than the target frame "+basis_name+".");
+    }
+    return ExpressedInSet(this->world, this->subject, basis, this->db, this->validation);
 }
\ No newline at end of file
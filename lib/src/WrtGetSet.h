@@ -3,10 +3,14 @@
 //Forward declaration
 class WrtGet;
 class WrtSet;
+struct CompiledGets;
 
 #include "DbConnector.h"
 #include "ExpressedIn.h"
+#include "NameTable.h"
 #include <string>
+#include <string_view>
+#include <memory>
 using namespace std;
 
 /**
@@ -18,20 +22,29 @@ using namespace std;
 class WrtGet
 {
 private:
-    /// Name of the world/database to work in.
-    string world_name;
-    /// Name of the subject frame.
-    string subject_name;
-    /// Name of the basis frame.
-    string basis_name;
+    /// Path to the world/database to work in, see NameTable::Worlds().
+    NameId world;
+    /// Name of the subject frame, see NameTable::Frames().
+    NameId subject;
+    /// Connection to the database shared with the rest of the query, opened on demand if empty.
+    shared_ptr<SQLite::Database> db;
+    /// Compiled queries shared by the queries started from the same GetSet object, if any.
+    shared_ptr<CompiledGets> compiled_gets;
 public:
     /**
      * @brief Interface to the Wrt operator. Do not use this class directly. For internal use only.
      * 
      * @param world_name: Name of the world/database to work in.
      * @param subject_frame: Name of the subject frame to Get().
+     * @param db: Connection to the database to use, a new one is opened if empty.
      */
-    WrtGet(string world_name, string subject_frame);
+    WrtGet(string_view world_name, string_view subject_frame, shared_ptr<SQLite::Database> db = nullptr);
+    /**
+     * @brief Same as above with interned names, which are already validated. For internal use only.
+     * 
+     * @param compiled_gets: Compiled queries reused by ExpressedInGet::Ei(), nullptr to compile each query for a single use.
+     */
+    WrtGet(NameId world, NameId subject, shared_ptr<SQLite::Database> db, shared_ptr<CompiledGets> compiled_gets);
     ~WrtGet();
     /**
      * @brief Specify the basis frame with respect to which the subject frame is defined.
@@ -40,7 +53,11 @@ public:
      * 
      * @return ExpressedInGet Interface to the Ei() operator.
      */
-    ExpressedInGet Wrt(string basis_frame);
+    ExpressedInGet Wrt(string_view basis_frame);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "table"_frame, see FrameName.
+     */
+    ExpressedInGet Wrt(FrameName basis_frame);
 };
 
 /**
@@ -52,20 +69,33 @@ public:
 class WrtSet
 {
 private:
-    /// Name of the world/database to work in.
-    string world_name;
-    /// Name of the subject frame.
-    string subject_name;
-    /// Name of the basis frame.
-    string basis_name;
+    /// Path to the world/database to work in, see NameTable::Worlds().
+    NameId world;
+    /// Name of the subject frame, see NameTable::Frames().
+    NameId subject;
+    /// Connection to the database shared with the rest of the query, opened on demand if empty.
+    shared_ptr<SQLite::Database> db;
+    /// How the pose is validated, see ConnectionOptions::validation.
+    PoseValidation validation;
+    /**
+     * @brief Specify the interned name of the basis frame, see Wrt().
+     */
+    ExpressedInSet Wrt(NameId basis);
 public:
     /**
      * @brief Interface to the Wrt operator. Do not use this class directly. For internal use only.
      * 
      * @param world_name: Name of the world/database to work in.
      * @param subject_frame: Name of the subject frame to Set().
+     * @param db: Connection to the database to use, a new one is opened if empty.
+     */
+    WrtSet(string_view world_name, string_view subject_frame, shared_ptr<SQLite::Database> db = nullptr);
+    /**
+     * @brief Same as above with interned names, which are already validated. For internal use only.
+     * 
+     * @param validation: How the pose is validated, see ConnectionOptions::validation.
      */
-    WrtSet(string world_name, string subject_frame);
+    WrtSet(NameId world, NameId subject, shared_ptr<SQLite::Database> db, PoseValidation validation);
     ~WrtSet();
     /**
      * @brief Specify the basis frame with respect to which the subject frame is defined.
@@ -74,5 +104,9 @@ public:
      * 
      * @return ExpressedInSet Interface to the Ei() operator.
      */
-    ExpressedInSet Wrt(string basis_frame);
+    ExpressedInSet Wrt(string_view basis_frame);
+    /**
+     * @brief Same as above with a name validated at compile time, e.g. "table"_frame, see FrameName.
+     */
+    ExpressedInSet Wrt(FrameName basis_frame);
 };
\ No newline at end of file
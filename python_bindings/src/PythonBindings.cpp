@@ -1,39 +1,153 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/embed.h>
 #include <pybind11/eigen.h>
+#include <pybind11/stl.h>
 #include "Wrt.h"
 namespace py = pybind11;
 
 PYBIND11_MODULE(with_respect_to, m) {
     m.doc() = "Provides an interface to set and get the pose of reference frames as homogeneous transformation matrices.";
+    py::register_exception<TimeoutError>(m, "TimeoutError", PyExc_RuntimeError);
+
     py::class_<DbConnector>(m, "DbConnector")
+        .def(py::init<std::string &, std::uint8_t &, ConnectionOptions>(), "Initialize access to the database located in the directory specified in argument (the default directory if empty), tuning the connections with the ConnectionOptions specified in argument.")
         .def(py::init<std::string &, std::uint8_t &>(), "Initialize access to the database located in the directory specified in argument.")
         .def(py::init<std::uint8_t &>(), "Initialize access to the database located in the user's home directory.")
         .def(py::init<>(),                 "Initialize access to the database located in the user's home directory.")
         .def("In", &DbConnector::In, "Creates or connects to the database named as specified in argument. The specified name can only include characters in ([a-z][0-9]-).");
 
+    py::class_<ConnectionOptions>(m, "ConnectionOptions")
+        .def(py::init<>(), "Default SQLite settings, with a busy timeout of 10 seconds.")
+        .def_static("ReadOptimized", &ConnectionOptions::ReadOptimized, "Settings for processes that mostly get poses.")
+        .def_static("WriteOptimized", &ConnectionOptions::WriteOptimized, "Settings for processes that mostly set poses.")
+        .def_readwrite("busy_timeout", &ConnectionOptions::busy_timeout, "Time in milliseconds to wait for a lock held by another connection before failing with a TimeoutError.")
+        .def_readwrite("busy_backoff_min", &ConnectionOptions::busy_backoff_min, "Time in microseconds to wait before the first retry when a lock is held by another connection, doubled at each retry.")
+        .def_readwrite("busy_backoff_max", &ConnectionOptions::busy_backoff_max, "Longest time in microseconds between two retries.")
+        .def_readwrite("mmap_size", &ConnectionOptions::mmap_size, "Maximum number of bytes of the database accessed through memory mapping, 0 to disable it.")
+        .def_readwrite("cache_size", &ConnectionOptions::cache_size, "Size of the page cache of each connection, in pages if positive or in KiB if negative.")
+        .def_readwrite("temp_store", &ConnectionOptions::temp_store, "Where temporary tables and indices are stored: default, file or memory.")
+        .def_readwrite("page_size", &ConnectionOptions::page_size, "Size in bytes of the pages of the worlds created.")
+        .def_readwrite("locking_mode", &ConnectionOptions::locking_mode, "Locking mode of the connections: normal or exclusive.")
+        .def_readwrite("validation", &ConnectionOptions::validation, "How the poses given to Set are checked: strict, tolerant (drifted rotations are orthonormalized) or trusted (no check).");
+
     py::class_<GetSet>(m, "GetSet")
         .def(py::init<std::string &>())
-        .def("Get", &GetSet::Get, "Name of the frame to get, which can only include characters in ([a-z][0-9]-).")
-        .def("Set", &GetSet::Set, "Name of the frame to set, which can only include characters in ([a-z][0-9]-).");
+        .def("Get", py::overload_cast<string_view>(&GetSet::Get), "Name of the frame to get, which can only include characters in ([a-z][0-9]-).")
+        .def("Set", py::overload_cast<string_view>(&GetSet::Set), "Name of the frame to set, which can only include characters in ([a-z][0-9]-).")
+        .def("Export", &GetSet::Export, "Write a binary snapshot of the world to the file specified in argument.")
+        .def("Import", &GetSet::Import, "Replace the content of the world by the content of the binary snapshot specified in argument, in a single transaction.")
+        .def("SetRetention", &GetSet::SetRetention, "Set how long the history of the world is kept and at which resolution, as a list of RetentionLevel from the finest to the coarsest.")
+        .def("History", &GetSet::History, py::arg("subject_name"), py::arg("start"), py::arg("end"), py::arg("resolution") = 0, "Recorded poses of a frame relative to its parent between two times, read from the coarsest level of the history that is fine enough.")
+        .def("Stats", &GetSet::Stats, "Counters and latency histograms collected by this process on the world, all zeros unless it was opened with the COLLECT_STATS flag.")
+        .def("Transaction", &GetSet::Transaction, py::arg("read_only") = false, "Start a transaction in which the following queries of this object run, to be used in a with statement. A read-only transaction reads a snapshot of the world.");
+
+    py::class_<WorldTransaction>(m, "WorldTransaction")
+        .def("Commit", &WorldTransaction::Commit, "Commit the Sets performed since the transaction started.")
+        .def("Rollback", &WorldTransaction::Rollback, "Discard the Sets performed since the transaction started.")
+        .def("Active", &WorldTransaction::Active, "Whether the transaction can still be committed or rolled back.")
+        .def("__enter__", [](WorldTransaction& transaction) -> WorldTransaction& { return transaction; }, py::return_value_policy::reference)
+        .def("__exit__", [](WorldTransaction& transaction, py::object type, py::object value, py::object traceback){
+            //Commit if the block completed, roll back if it raised, unless the block already ended the transaction.
+            if(transaction.Active()){
+                if(type.is_none())
+                    transaction.Commit();
+                else
+                    transaction.Rollback();
+            }
+            return false;
+        });
+
+    py::class_<Histogram>(m, "Histogram")
+        .def_readonly("buckets", &Histogram::buckets, "Number of values in each bucket, bucket i counting the values in [2^(i-1), 2^i).")
+        .def_readonly("count", &Histogram::count)
+        .def_readonly("sum", &Histogram::sum)
+        .def_readonly("max", &Histogram::max)
+        .def("Quantile", &Histogram::Quantile, "Upper bound of the bucket holding the specified quantile, between 0 and 1.");
+
+    py::class_<WorldStats>(m, "WorldStats")
+        .def_readonly("db_opens", &WorldStats::db_opens)
+        .def_readonly("statements_prepared", &WorldStats::statements_prepared)
+        .def_readonly("rows_read", &WorldStats::rows_read)
+        .def_readonly("commits", &WorldStats::commits)
+        .def_readonly("busy_retries", &WorldStats::busy_retries, "Number of times another connection held a lock needed by this process.")
+        .def_readonly("errors", &WorldStats::errors)
+        .def_readonly("get_latency", &WorldStats::get_latency, "Latency of the Get operations, in nanoseconds.")
+        .def_readonly("set_latency", &WorldStats::set_latency, "Latency of the Set operations, in nanoseconds.")
+        .def_readonly("depth", &WorldStats::depth, "Number of frames walked up to the root of the tree by the Get operations.")
+        .def("ToJson", &WorldStats::ToJson, "Serialize the statistics as a JSON object.");
+
+    py::class_<RetentionLevel>(m, "RetentionLevel")
+        .def(py::init([](double resolution, double duration){ return RetentionLevel{resolution, duration}; }), py::arg("resolution"), py::arg("duration"), "Keep the samples at the specified resolution (0 for every sample) for the specified duration, in seconds.")
+        .def_readwrite("resolution", &RetentionLevel::resolution)
+        .def_readwrite("duration", &RetentionLevel::duration);
+
+    py::class_<PoseSample>(m, "PoseSample")
+        .def_readonly("time", &PoseSample::time)
+        .def_readonly("parent_name", &PoseSample::parent_name)
+        .def_readonly("pose", &PoseSample::pose);
+
+    py::class_<Compactor>(m, "Compactor")
+        .def(py::init<GetSet, size_t>(), py::arg("world"), py::arg("rows_per_step") = 1000, "Prepare the compaction of the history of a world according to its retention policy.")
+        .def("Step", &Compactor::Step, "Perform a bounded amount of compaction in a single transaction and return whether more work remains.")
+        .def("Start", &Compactor::Start, "Compact the history in a background thread, checking it again every period seconds, until Stop() is called.")
+        .def("Stop", &Compactor::Stop, "Stop the background compaction.")
+        .def("LastError", &Compactor::LastError, "Error that made the last step of the background compaction fail, empty if none since Start().");
 
     py::class_<WrtGet>(m, "WrtGet")
         .def(py::init<std::string &, std::string &>())
-        .def("Wrt", &WrtGet::Wrt, "Name of the reference frame the frame is described with respect to, frame names can only include characters in ([a-z][0-9]-).");
+        .def("Wrt", py::overload_cast<string_view>(&WrtGet::Wrt), "Name of the reference frame the frame is described with respect to, frame names can only include characters in ([a-z][0-9]-).");
     
     py::class_<WrtSet>(m, "WrtSet")
         .def(py::init<std::string &, std::string &>())
-        .def("Wrt", &WrtSet::Wrt, "Name of the reference frame the frame is described with respect to, frame names can only include characters in ([a-z][0-9]-).");
+        .def("Wrt", py::overload_cast<string_view>(&WrtSet::Wrt), "Name of the reference frame the frame is described with respect to, frame names can only include characters in ([a-z][0-9]-).");
 
     py::class_<ExpressedInGet>(m, "ExpressedInGet")
         .def(py::init<std::string &, std::string &, std::string &>())
-        .def("Ei", &ExpressedInGet::Ei, "Name of the reference frame the frame is expressed in, which can only include characters in ([a-z][0-9]-).");
+        .def("Ei", static_cast<Eigen::Matrix4d (ExpressedInGet::*)(string_view)>(&ExpressedInGet::Ei), "Name of the reference frame the frame is expressed in, which can only include characters in ([a-z][0-9]-).")
+        .def("At", &ExpressedInGet::At, "Time in seconds since the epoch at which the pose is desired, interpolated from the history of the world.")
+        .def("Within", &ExpressedInGet::Within, "Time in milliseconds the Get can wait for locks held by other connections before failing with a TimeoutError.")
+        .def("Compile", &ExpressedInGet::Compile, "Validate the query once for the reference frame the frame is expressed in and return a handle that can be called repeatedly to get the pose.");
 
     py::class_<ExpressedInSet>(m, "ExpressedInSet")
         .def(py::init<std::string &, std::string &, std::string &>())
-        .def("Ei", &ExpressedInSet::Ei, "Name of the reference frame the frame is expressed in, which can only include characters in ([a-z][0-9]-).");
+        .def("Ei", py::overload_cast<string_view>(&ExpressedInSet::Ei), "Name of the reference frame the frame is expressed in, which can only include characters in ([a-z][0-9]-).");
     
     py::class_<SetAs>(m, "SetAs")
         .def(py::init<std::string &, std::string &, std::string &, std::string &>())
-        .def("As", &SetAs::As, "Homogeneous 4x4 transformation numpy.ndarray defining the pose with rotation R and translation t like such: [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]");
+        .def("As", py::overload_cast<Eigen::Matrix4d>(&SetAs::As), "Homogeneous 4x4 transformation numpy.ndarray defining the pose with rotation R and translation t like such: [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]")
+        .def("As", py::overload_cast<Eigen::Matrix4d, double>(&SetAs::As), "Same as As(pose) but the pose is recorded in the history of the world as valid from the specified time on, in seconds since the epoch.")
+        .def("As", py::overload_cast<const PoseArray&>(&SetAs::As), "Pose as a list [x, y, z, qx, qy, qz, qw] of the position and of the quaternion giving the orientation, which is normalized.")
+        .def("As", py::overload_cast<const PoseArray&, double>(&SetAs::As), "Same as As(pose) with the pose as a list [x, y, z, qx, qy, qz, qw], recorded in the history of the world as valid from the specified time on.")
+        .def("Compile", &SetAs::Compile, "Validate the query once and return a handle whose As() method can be called repeatedly to set the pose.")
+        .def("Within", &SetAs::Within, "Time in milliseconds the Set can wait for locks held by other connections before failing with a TimeoutError.");
+
+    py::class_<CompiledGet>(m, "CompiledGet")
+        .def(py::init<std::string &, std::string &, std::string &, std::string &>())
+        .def("__call__", &CompiledGet::operator(), "Evaluate the compiled query and return the pose as a homogeneous 4x4 transformation numpy.ndarray.")
+        .def("Within", &CompiledGet::Within, py::return_value_policy::reference_internal, "Time in milliseconds each evaluation can wait for locks held by other connections before failing with a TimeoutError.");
+
+    py::class_<CompiledSet>(m, "CompiledSet")
+        .def(py::init<std::string &, std::string &, std::string &, std::string &>())
+        .def("As", py::overload_cast<Eigen::Matrix4d>(&CompiledSet::As), "Homogeneous 4x4 transformation numpy.ndarray defining the pose with rotation R and translation t like such: [[R00,R01,R02,t0],[R10,R11,R12,t1],[R20,R21,R22,t2],[0,0,0,1]]")
+        .def("As", py::overload_cast<Eigen::Matrix4d, double>(&CompiledSet::As), "Same as As(pose) but the pose is recorded in the history of the world as valid from the specified time on, in seconds since the epoch.")
+        .def("As", py::overload_cast<const PoseArray&>(&CompiledSet::As), "Pose as a list [x, y, z, qx, qy, qz, qw] of the position and of the quaternion giving the orientation, which is normalized.")
+        .def("As", py::overload_cast<const PoseArray&, double>(&CompiledSet::As), "Same as As(pose) with the pose as a list [x, y, z, qx, qy, qz, qw], recorded in the history of the world as valid from the specified time on.")
+        .def("Within", &CompiledSet::Within, py::return_value_policy::reference_internal, "Time in milliseconds each call to As() can wait for locks held by other connections before failing with a TimeoutError.");
+
+    py::class_<DaemonClient>(m, "DaemonClient")
+        .def(py::init<std::string, std::string>(), py::arg("socket_path") = Daemon::DefaultSocketPath(), py::arg("dir") = "", "Connect to the daemon listening on the specified UNIX domain socket. The databases are looked for in dir, or in the default directory of the daemon if empty.")
+        .def_static("IsRunning", &DaemonClient::IsRunning, py::arg("socket_path") = Daemon::DefaultSocketPath(), "Check if a daemon is listening on the specified UNIX domain socket.")
+        .def("Get", &DaemonClient::Get, "Get(world, frame, reference_frame, expressed_in_frame) returns the pose as a homogeneous 4x4 transformation numpy.ndarray.")
+        .def("Set", &DaemonClient::Set, "Set(world, frame, reference_frame, expressed_in_frame, pose) sets the pose from a homogeneous 4x4 transformation numpy.ndarray.")
+        .def("SendGet", &DaemonClient::SendGet, "Queue a Get request without waiting for its response, which must be read with Receive().")
+        .def("SendSet", &DaemonClient::SendSet, "Queue a Set request without waiting for its response, which must be read with Receive().")
+        .def("Receive", &DaemonClient::Receive, "Read the response to the oldest queued request.");
+
+    py::class_<Snapshot>(m, "Snapshot")
+        .def(py::init<std::string>(), "Map the binary snapshot specified in argument in memory, after verifying its checksum.")
+        .def("Size", &Snapshot::Size, "Number of frames in the snapshot.")
+        .def("Name", &Snapshot::Name, "Name of the frame at the specified index.")
+        .def("Parent", &Snapshot::Parent, "Name of the parent of the frame at the specified index, empty if the frame has no parent.")
+        .def("Pose", &Snapshot::Pose, "Pose of the frame at the specified index with respect to its parent, as a homogeneous 4x4 transformation numpy.ndarray.")
+        .def("Find", &Snapshot::Find, "Index of the frame named as specified in argument.");
 }
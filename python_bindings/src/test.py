@@ -30,5 +30,90 @@ assert(SE3(db.In('test').Get('c').Wrt('world').Ei('a'))      == SE3(np.array([[1
 assert(SE3(db.In('test').Get('d').Wrt('a').Ei('a'))          == SE3(np.array([[0,-1,0,1],[0,0,-1,0],[1,0,0,1],[0,0,0,1]])))
 assert(SE3(db.In('test').Get('d').Wrt('world').Ei('a'))      == SE3(np.array([[0,-1,0,2],[0,0,-1,1],[1,0,0,2],[0,0,0,1]])))
 
+try:
+    db.In('test').Set('a').Wrt('c').Ei('c').As(np.eye(4))
+    assert(False)
+except RuntimeError:
+    pass
+
+get_c = db.In('test').Get('c').Wrt('world').Compile('a')
+assert(SE3(get_c())                                         == SE3(np.array([[1,0,0,2],[0,0,-1,1],[0,1,0,1],[0,0,0,1]])))
+set_a = db.In('test').Set('a').Wrt('world').Ei('world').Compile()
+set_a.As(np.array([[1,0,0,2],[0,1,0,1],[0,0,1,1],[0,0,0,1]]))
+assert(SE3(get_c())                                         == SE3(np.array([[1,0,0,3],[0,0,-1,1],[0,1,0,1],[0,0,0,1]])))
+
+db.In('test').Export('/tmp/wrt-test-python.wrts')
+snapshot = WRT.Snapshot('/tmp/wrt-test-python.wrts')
+assert(snapshot.Parent(snapshot.Find('c'))                  == 'b')
+db.In('test-snapshot').Import('/tmp/wrt-test-python.wrts')
+assert(SE3(db.In('test-snapshot').Get('c').Wrt('world').Ei('a')) == SE3(get_c()))
+
+RECORD_HISTORY = 2
+history = WRT.DbConnector(TEMPORARY_DATABASE | RECORD_HISTORY)
+history.In('test-history').Set('a').Wrt('world').Ei('world').As(np.eye(4), 10)
+history.In('test-history').Set('a').Wrt('world').Ei('world').As(np.array([[1,0,0,10],[0,1,0,0],[0,0,1,0],[0,0,0,1]]), 20)
+assert(SE3(history.In('test-history').Get('a').Wrt('world').At(15).Ei('world')) == SE3(np.array([[1,0,0,5],[0,1,0,0],[0,0,1,0],[0,0,0,1]])))
+
+assert(len(history.In('test-history').History('a', 0, 30)) == 2)
+history.In('test-history').SetRetention([WRT.RetentionLevel(0, 3600), WRT.RetentionLevel(1, 86400)])
+compactor = WRT.Compactor(history.In('test-history'))
+while compactor.Step():
+    pass
+assert(len(history.In('test-history').History('a', 0, 30)) == 0)
+
+options = WRT.ConnectionOptions.ReadOptimized()
+options.cache_size = -16384
+reader = WRT.DbConnector('', TEMPORARY_DATABASE, options)
+assert(SE3(reader.In('test').Get('c').Wrt('world').Ei('a'))   == SE3(get_c()))
+
+drifted = np.eye(4)
+drifted[:3,:3] *= 1.00001
+options = WRT.ConnectionOptions()
+options.validation = 'tolerant'
+tolerant = WRT.DbConnector('', TEMPORARY_DATABASE, options)
+tolerant.In('test-validation').Set('a').Wrt('world').Ei('world').As(drifted)
+assert(np.allclose(tolerant.In('test-validation').Get('a').Wrt('world').Ei('world'), np.eye(4), atol=1e-12))
+
+COLLECT_STATS = 4
+counted = WRT.DbConnector(TEMPORARY_DATABASE | COLLECT_STATS)
+counted.In('test-stats').Set('a').Wrt('world').Ei('world').As(np.eye(4))
+counted.In('test-stats').Get('a').Wrt('world').Ei('world')
+stats = counted.In('test-stats').Stats()
+assert(stats.set_latency.count == 1 and stats.get_latency.count == 1 and stats.commits == 1)
+assert(db.In('test').Stats().get_latency.count == 0)
+
+import sqlite3
+other = sqlite3.connect('/tmp/test.db', isolation_level=None)
+other.execute('BEGIN IMMEDIATE')
+try:
+    db.In('test').Set('a').Wrt('world').Ei('world').Within(20).As(np.eye(4))
+    assert(False)
+except WRT.TimeoutError:
+    pass
+other.execute('ROLLBACK')
+other.close()
+
+world = db.In('test')
+pose = np.eye(4)
+pose[0,3] = 5
+try:
+    with world.Transaction():
+        world.Set('a').Wrt('world').Ei('world').As(pose)
+        raise ValueError()
+except ValueError:
+    pass
+assert(world.Get('a').Wrt('world').Ei('world')[0,3] != 5)
+with world.Transaction():
+    world.Set('a').Wrt('world').Ei('world').As(pose)
+assert(db.In('test').Get('a').Wrt('world').Ei('world')[0,3] == 5)
+
+world.Set('g').Wrt('a').Ei('a').As([1, 2, 3, 0, 0, 0, 2])
+assert(np.allclose(world.Get('g').Wrt('a').Ei('a'), [[1,0,0,1],[0,1,0,2],[0,0,1,3],[0,0,0,1]]))
+
+SINGLE_PRECISION = 8
+compact = WRT.DbConnector(TEMPORARY_DATABASE | SINGLE_PRECISION)
+compact.In('test-float').Set('a').Wrt('world').Ei('world').As(pose)
+assert(np.allclose(compact.In('test-float').Get('a').Wrt('world').Ei('world'), pose))
+
 print("All tests passed!")
 
@@ -4,6 +4,10 @@
 #include <string>
 #include <cfloat>
 #include <math.h>
+#include <thread>
+#include <fstream>
+#include <atomic>
+#include <cstdlib>
 #include "Wrt.h"
 
 using namespace std;
@@ -11,6 +15,28 @@ using Eigen::Affine3d;
 using Eigen::Matrix3d;
 using Eigen::AngleAxisd;
 using Eigen::Vector3d;
+using Eigen::Quaterniond;
+using Eigen::Isometry3d;
+using Eigen::Isometry3f;
+using Eigen::Matrix4f;
+
+//Number of memory allocations made by the process, to check that the hot paths do not allocate.
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t size){
+    allocations++;
+    if(void* memory = malloc(size))
+        return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept{
+    free(memory);
+}
  
 double deg_to_rad(double angle){
     return angle * M_PI / 180;
@@ -84,5 +110,514 @@ int main()
     pose.matrix() << 0,-1,0,2, 0,0,-1,1, 1,0,0,2, 0,0,0,1;
     assert(wrt.In("test").Get("d").Wrt("world").Ei("a").matrix().isApprox(pose.matrix()));
 
+    //Kinematic loops are refused when setting a pose, including through frames that are not defined yet.
+    {
+        bool failed = false;
+        try{ wrt.In("test").Set("a").Wrt("c").Ei("c").As(pose.matrix()); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        failed = false;
+        try{ wrt.In("test").Set("f").Wrt("g").Ei("g").As(Eigen::Matrix4d::Identity()); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+    }
+
+    //Compiled queries give the same result and follow changes made to the database.
+    auto get_c = wrt.In("test").Get("c").Wrt("world").Compile("a");
+    pose.matrix() << 1,0,0,2, 0,0,-1,1, 0,1,0,1, 0,0,0,1;
+    assert(get_c().isApprox(pose.matrix()));
+    assert(get_c().isApprox(pose.matrix()));
+    auto set_a = wrt.In("test").Set("a").Wrt("world").Ei("world").Compile();
+    pose.matrix() << 1,0,0,2, 0,1,0,1, 0,0,1,1, 0,0,0,1;
+    set_a.As(pose.matrix());
+    pose.matrix() << 1,0,0,3, 0,0,-1,1, 0,1,0,1, 0,0,0,1;
+    assert(get_c().isApprox(pose.matrix()));
+    pose.matrix() << 1,0,0,1, 0,1,0,1, 0,0,1,1, 0,0,0,1;
+    set_a.As(pose.matrix());
+    pose.matrix() << 1,0,0,2, 0,0,-1,1, 0,1,0,1, 0,0,0,1;
+    assert(get_c().isApprox(pose.matrix()));
+
+    //Poses written in bulk are only visible to other connections once committed.
+    {
+        BulkWriter writer(wrt.In("test"), 1000);
+        pose.matrix() << 1,0,0,0, 0,1,0,0, 0,0,1,5, 0,0,0,1;
+        for(int i = 0; i < 10; i++)
+            writer.Set("bulk-"+to_string(i), i == 0 ? "world" : "bulk-"+to_string(i-1), "world", pose.matrix());
+        bool failed = false;
+        try{ wrt.In("test").Get("bulk-9").Wrt("world").Ei("world"); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        writer.Commit();
+        assert(writer.Count() == 10);
+        pose.matrix() << 1,0,0,0, 0,1,0,0, 0,0,1,50, 0,0,0,1;
+        assert(wrt.In("test").Get("bulk-9").Wrt("world").Ei("world").isApprox(pose.matrix()));
+    }
+
+    //Writers in bulk wait for each other's transactions instead of failing.
+    {
+        auto world = wrt.In("test");
+        atomic<int> failures(0);
+        vector<thread> writers;
+        for(int t = 0; t < 2; t++)
+            writers.emplace_back([world, &failures, t](){
+                try{
+                    BulkWriter writer(world, 5);
+                    for(int i = 0; i < 200; i++)
+                        writer.Set("contended-"+to_string(t)+"-"+to_string(i % 10), "world", "world", Eigen::Matrix4d::Identity());
+                    writer.Commit();
+                }catch(const runtime_error& err){
+                    failures++;
+                }
+            });
+        for(auto& writer : writers)
+            writer.join();
+        assert(failures == 0);
+    }
+
+    //There is no limit on the depth of the tree.
+    {
+        BulkWriter writer(wrt.In("test"), 100000);
+        pose.matrix() << 1,0,0,0, 0,1,0,0, 0,0,1,0.001, 0,0,0,1;
+        for(int i = 0; i < 10000; i++)
+            writer.Set("deep-"+to_string(i), i == 0 ? "world" : "deep-"+to_string(i-1), i == 0 ? "world" : "deep-"+to_string(i-1), pose.matrix());
+        writer.Commit();
+        pose.matrix() << 1,0,0,0, 0,1,0,0, 0,0,1,10, 0,0,0,1;
+        assert(wrt.In("test").Get("deep-9999").Wrt("world").Ei("world").isApprox(pose.matrix()));
+    }
+
+    //The daemon answers the same queries as the library, pipelined requests included, with caches smaller than the queries.
+    {
+        Daemon daemon("/tmp/wrt-test-daemon.sock", 1, 2);
+        thread server([&daemon](){ daemon.Serve(); });
+        {
+            DaemonClient client("/tmp/wrt-test-daemon.sock", "/tmp");
+            assert(client.Get("test", "c", "world", "a").isApprox(wrt.In("test").Get("c").Wrt("world").Ei("a")));
+            pose.matrix() << 1,0,0,1, 0,1,0,1, 0,0,1,1, 0,0,0,1;
+            client.SendSet("test", "a", "world", "world", pose.matrix());
+            client.SendGet("test", "a", "world", "world");
+            client.SendGet("test", "undefined", "world", "world");
+            client.Receive();
+            assert(client.Receive().isApprox(pose.matrix()));
+            bool failed = false;
+            try{ client.Receive(); }catch(const runtime_error& err){ failed = true; }
+            assert(failed);
+            //The queries compiled by the daemon are checked as those of the library.
+            failed = false;
+            try{ client.Set("test", "world", "a", "world", pose.matrix()); }catch(const runtime_error& err){ failed = true; }
+            assert(failed);
+            for(int i = 0; i < 3; i++)
+                for(string frame : {"a", "b", "c"})
+                    assert(client.Get("test", frame, "world", "world").isApprox(wrt.In("test").Get(frame).Wrt("world").Ei("world")));
+            //A Set blocked by another process gives up quickly instead of stalling the other requests.
+            SQLite::Database other("/tmp/test.db", SQLite::OPEN_READWRITE);
+            other.exec("BEGIN IMMEDIATE");
+            auto start = chrono::steady_clock::now();
+            failed = false;
+            try{ client.Set("test", "a", "world", "world", pose.matrix()); }catch(const runtime_error& err){ failed = true; }
+            assert(failed && chrono::steady_clock::now() - start < chrono::seconds(1));
+            assert(client.Get("test", "a", "world", "world").isApprox(pose.matrix()));
+            other.exec("ROLLBACK");
+        }
+        daemon.Stop();
+        server.join();
+    }
+
+    //A snapshot holds the whole world and can be loaded into another one, but not once corrupted.
+    {
+        wrt.In("test").Export("/tmp/wrt-test.wrts");
+        {
+            Snapshot snapshot("/tmp/wrt-test.wrts");
+            size_t index = snapshot.Find("bulk-9");
+            assert(snapshot.Parent(index) == "bulk-8");
+            assert(snapshot.Pose(index).isApprox(wrt.In("test").Get("bulk-9").Wrt("bulk-8").Ei("bulk-8")));
+        }
+        wrt.In("test-snapshot").Set("a").Wrt("world").Ei("world").As(Eigen::Matrix4d::Identity());
+        wrt.In("test-snapshot").Import("/tmp/wrt-test.wrts");
+        assert(wrt.In("test-snapshot").Get("c").Wrt("world").Ei("a").isApprox(wrt.In("test").Get("c").Wrt("world").Ei("a")));
+        //Within a transaction, the import is undone with the rest of the transaction.
+        {
+            auto world = wrt.In("test-empty");
+            auto transaction = world.Transaction();
+            world.Import("/tmp/wrt-test.wrts");
+            assert(world.Get("c").Wrt("world").Ei("a").isApprox(wrt.In("test").Get("c").Wrt("world").Ei("a")));
+        }
+        bool undone = false;
+        try{ wrt.In("test-empty").Get("c").Wrt("world").Ei("world"); }catch(const runtime_error& err){ undone = true; }
+        assert(undone);
+        fstream file("/tmp/wrt-test.wrts", ios::in | ios::out | ios::binary);
+        file.seekp(100);
+        file.put('x');
+        file.close();
+        bool failed = false;
+        try{ Snapshot snapshot("/tmp/wrt-test.wrts"); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+    }
+
+    //Past poses are interpolated from the history, edge by edge.
+    {
+        auto history = DbConnector(DbConnector::TEMPORARY_DATABASE | DbConnector::RECORD_HISTORY);
+        pose = Affine3d::Identity();
+        history.In("test-history").Set("a").Wrt("world").Ei("world").As(pose.matrix(), 10);
+        pose.linear() = AngleAxisd(deg_to_rad(90), Vector3d::UnitZ()).toRotationMatrix();
+        pose.translation() << 10,0,0;
+        history.In("test-history").Set("a").Wrt("world").Ei("world").As(pose.matrix(), 20);
+        pose = Affine3d::Identity();
+        pose.translation() << 1,0,0;
+        history.In("test-history").Set("b").Wrt("a").Ei("a").As(pose.matrix(), 10);
+        pose.linear() = AngleAxisd(deg_to_rad(45), Vector3d::UnitZ()).toRotationMatrix();
+        pose.translation() << 5 + sqrt(0.5), sqrt(0.5), 0;
+        assert(history.In("test-history").Get("b").Wrt("world").At(15).Ei("world").isApprox(pose.matrix()));
+        pose.linear() = AngleAxisd(deg_to_rad(90), Vector3d::UnitZ()).toRotationMatrix();
+        pose.translation() << 10,1,0;
+        assert(history.In("test-history").Get("b").Wrt("world").At(25).Ei("world").isApprox(pose.matrix()));
+        assert(history.In("test-history").Get("b").Wrt("world").Ei("world").isApprox(pose.matrix()));
+        bool failed = false;
+        try{ history.In("test-history").Get("b").Wrt("world").At(5).Ei("world"); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+
+        //Old samples are decimated into the coarser levels, which are read transparently.
+        auto world = history.In("test-retention");
+        double now = CurrentTime();
+        pose = Affine3d::Identity();
+        for(int i = 0; i <= 200; i++){
+            pose.translation() << i * 0.5 - 100, 0, 0;
+            world.Set("r").Wrt("world").Ei("world").As(pose.matrix(), now - 100 + i * 0.5);
+        }
+        //A frame that rarely moves keeps its last sample before the retention window, which still gives its pose in it.
+        pose.translation() << 0, 3, 0;
+        world.Set("rare").Wrt("world").Ei("world").As(pose.matrix(), now - 2000);
+        world.Set("rare").Wrt("world").Ei("world").As(pose.matrix(), now - 1);
+        world.SetRetention({{0, 10}, {5, 1000}});
+        Compactor compactor(world, 50);
+        while(compactor.Step());
+        SQLite::Database raw("/tmp/test-retention.db");
+        SQLite::Statement count(raw, "SELECT count(*) FROM history WHERE name = 'r'");
+        count.executeStep();
+        assert(count.getColumn(0).getInt() <= 22);
+        assert(world.Get("rare").Wrt("world").At(now - 5).Ei("world").isApprox(pose.matrix()));
+        assert(world.Get("rare").Wrt("world").At(now - 500).Ei("world").isApprox(pose.matrix()));
+        assert(world.History("r", now - 5, now).size() == 11);
+        auto coarse = world.History("r", now - 100, now);
+        assert(coarse.size() >= 20 && coarse.size() <= 22);
+        pose.translation() << -50, 0, 0;
+        assert(world.Get("r").Wrt("world").At(now - 50).Ei("world").isApprox(pose.matrix()));
+        compactor.Start(0.01);
+        compactor.Stop();
+        assert(compactor.LastError().empty());
+        //The errors of the background compaction are kept, such as a world locked for longer than the busy timeout.
+        ConnectionOptions impatient;
+        impatient.busy_timeout = 10;
+        Compactor blocked(DbConnector("/tmp", 0, impatient).In("test-retention"));
+        SQLite::Database locker("/tmp/test-retention.db", SQLite::OPEN_READWRITE);
+        locker.exec("BEGIN IMMEDIATE");
+        blocked.Start(0.01);
+        this_thread::sleep_for(chrono::milliseconds(200));
+        blocked.Stop();
+        locker.exec("ROLLBACK");
+        assert(!blocked.LastError().empty());
+    }
+
+    //Tuned connections give the same results, invalid settings are refused.
+    {
+        auto tuned = DbConnector("", DbConnector::TEMPORARY_DATABASE, ConnectionOptions::WriteOptimized());
+        pose.matrix() << 1,0,0,2, 0,0,-1,1, 0,1,0,1, 0,0,0,1;
+        tuned.In("test-tuned").Set("a").Wrt("world").Ei("world").As(pose.matrix());
+        auto reader = DbConnector("/tmp", 0, ConnectionOptions::ReadOptimized());
+        assert(reader.In("test-tuned").Get("a").Wrt("world").Ei("world").isApprox(pose.matrix()));
+        ConnectionOptions options;
+        options.temp_store = "disk";
+        bool failed = false;
+        try{ DbConnector("", 0, options); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+    }
+
+    //Drifted rotations are refused by the strict validation, orthonormalized by the tolerant one and stored as is when trusted.
+    {
+        Eigen::Matrix4d drifted = Eigen::Matrix4d::Identity();
+        drifted.topLeftCorner<3,3>() = AngleAxisd(0.5, Vector3d::UnitZ()).toRotationMatrix() * 1.00001;
+        auto strict = DbConnector("", DbConnector::TEMPORARY_DATABASE);
+        bool failed = false;
+        try{ strict.In("test-validation").Set("a").Wrt("world").Ei("world").As(drifted); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        Eigen::Matrix4d reflection = Eigen::Matrix4d::Identity();
+        reflection(0,0) = -1;
+        failed = false;
+        try{ strict.In("test-validation").Set("a").Wrt("world").Ei("world").As(reflection); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        ConnectionOptions options;
+        options.validation = "tolerant";
+        auto tolerant = DbConnector("", DbConnector::TEMPORARY_DATABASE, options);
+        tolerant.In("test-validation").Set("a").Wrt("world").Ei("world").As(drifted);
+        Eigen::Matrix3d R = tolerant.In("test-validation").Get("a").Wrt("world").Ei("world").topLeftCorner<3,3>();
+        assert((R * R.transpose()).isApprox(Eigen::Matrix3d::Identity(), 1e-12));
+        assert(R.isApprox(AngleAxisd(0.5, Vector3d::UnitZ()).toRotationMatrix(), 1e-12));
+        failed = false;
+        try{ tolerant.In("test-validation").Set("a").Wrt("world").Ei("world").As(reflection); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        options.validation = "trusted";
+        auto trusted = DbConnector("", DbConnector::TEMPORARY_DATABASE, options);
+        trusted.In("test-validation").Set("a").Wrt("world").Ei("world").As(drifted);
+        assert(trusted.In("test-validation").Get("a").Wrt("world").Ei("world").isApprox(drifted));
+        options.validation = "lenient";
+        failed = false;
+        try{ DbConnector("/tmp", 0, options).In("test-validation"); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+    }
+
+    //Rigid transformations compose and invert like the homogeneous matrices, with either representation of the rotation.
+    {
+        Affine3d X_A_B = Affine3d::Identity(), X_B_C = Affine3d::Identity();
+        X_A_B.linear() = AngleAxisd(0.3, Vector3d(1,2,3).normalized()).toRotationMatrix();
+        X_A_B.translation() << 1,-2,3;
+        X_B_C.linear() = AngleAxisd(-1.2, Vector3d::UnitY()).toRotationMatrix();
+        X_B_C.translation() << 0.5,0,-1;
+        SE3 se3_A_B(X_A_B.matrix()), se3_B_C(X_B_C.matrix());
+        assert((se3_B_C * se3_A_B).Matrix().isApprox((X_B_C * X_A_B).matrix()));
+        assert(se3_A_B.Inverse().Matrix().isApprox(X_A_B.inverse().matrix()));
+        assert((se3_A_B.Inverse() * se3_A_B).Matrix().isApprox(Eigen::Matrix4d::Identity()));
+        assert((SE3Quaternion(se3_B_C) * SE3Quaternion(se3_A_B)).Matrix().isApprox((X_B_C * X_A_B).matrix()));
+        assert(SE3Quaternion(se3_A_B).Inverse().Matrix().isApprox(X_A_B.inverse().matrix()));
+        assert((se3_A_B * Vector3d(1,1,1)).isApprox(X_A_B * Vector3d(1,1,1)));
+        assert(se3_A_B.Reexpressed(se3_B_C.rotation).translation.isApprox(X_B_C.linear() * X_A_B.translation()));
+        assert(SE3(Interpolate(SE3Quaternion(se3_A_B), SE3Quaternion(se3_B_C), 1)).Matrix().isApprox(X_B_C.matrix()));
+    }
+
+    //A world created with SINGLE_PRECISION stores packed floats, for every connection, and snapshots convert between precisions.
+    {
+        auto compact = DbConnector(DbConnector::TEMPORARY_DATABASE | DbConnector::SINGLE_PRECISION);
+        pose.matrix() << 1,0,0,2, 0,0,-1,1, 0,1,0,1, 0,0,0,1;
+        for(auto world : {compact.In("test-float"), wrt.In("test-double")}){
+            world.Set("a").Wrt("world").Ei("world").As(pose.matrix());
+            world.Set("b").Wrt("a").Ei("world").As(pose.matrix());
+        }
+        Eigen::Matrix4d expected = wrt.In("test-double").Get("b").Wrt("world").Ei("a");
+        assert(compact.In("test-float").Get("b").Wrt("world").Ei("a").isApprox(expected, 1e-6));
+        DbConnector("/tmp", 0).In("test-float").Set("c").Wrt("b").Ei("b").As(pose.matrix());
+        assert(compact.In("test-float").Get("c").Wrt("b").Ei("b").isApprox(pose.matrix(), 1e-6));
+        //A pose read from the world can be set again, although its rotation was stored in single precision.
+        Affine3d tilted = Eigen::Translation3d(0.1, 0.2, 0.3) * AngleAxisd(0.3, Vector3d(1, 2, 3).normalized());
+        compact.In("test-float").Set("d").Wrt("world").Ei("world").As(tilted.matrix());
+        Eigen::Matrix4d read = compact.In("test-float").Get("d").Wrt("world").Ei("world");
+        compact.In("test-float").Set("e").Wrt("world").Ei("world").As(read);
+        assert(compact.In("test-float").Get("e").Wrt("world").Ei("world").isApprox(tilted.matrix(), 1e-6));
+        SQLite::Database db("/tmp/test-float.db");
+        SQLite::Statement size(db, "SELECT length(pose) FROM frames WHERE name = 'c'");
+        assert(DbConnector::IsSinglePrecision(db) && size.executeStep() && size.getColumn(0).getInt() == 48);
+        compact.In("test-float").Export("/tmp/wrt-test-float.wrts");
+        wrt.In("test-double").Import("/tmp/wrt-test-float.wrts");
+        assert(wrt.In("test-double").Get("c").Wrt("world").Ei("a").isApprox(compact.In("test-float").Get("c").Wrt("world").Ei("a")));
+        wrt.In("test-double").Export("/tmp/wrt-test-float.wrts");
+        compact.In("test-float").Import("/tmp/wrt-test-float.wrts");
+        assert(compact.In("test-float").Get("c").Wrt("world").Ei("a").isApprox(wrt.In("test-double").Get("c").Wrt("world").Ei("a"), 1e-6));
+        remove("/tmp/wrt-test-float.wrts");
+    }
+
+    //Statistics are only collected for the worlds opened with COLLECT_STATS, failures included.
+    {
+        assert(wrt.In("test").Stats().get_latency.count == 0);
+        auto counted = DbConnector(DbConnector::TEMPORARY_DATABASE | DbConnector::COLLECT_STATS);
+        auto world = counted.In("test-stats");
+        pose = Affine3d::Identity();
+        world.Set("a").Wrt("world").Ei("world").As(pose.matrix());
+        world.Set("b").Wrt("a").Ei("a").As(pose.matrix());
+        world.Get("b").Wrt("world").Ei("world");
+        bool failed = false;
+        try{ world.Get("undefined").Wrt("world").Ei("world"); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        WorldStats stats = world.Stats();
+        assert(stats.db_opens == 1);
+        assert(stats.commits == 2);
+        assert(stats.set_latency.count == 2 && stats.get_latency.count == 1 && stats.errors == 1);
+        assert(stats.get_latency.Quantile(0.99) <= stats.get_latency.max && stats.get_latency.max > 0);
+        //The walk from b reads b, a and world, the basis and csys being the root.
+        assert(stats.depth.max == 3);
+        assert(stats.statements_prepared > 0 && stats.rows_read > 0);
+        assert(stats.ToJson().find("\"commits\": 2") != string::npos);
+    }
+
+    //A reversed Set writes the basis frame in the single transaction of the Set.
+    {
+        auto counted = DbConnector(DbConnector::TEMPORARY_DATABASE | DbConnector::COLLECT_STATS);
+        auto world = counted.In("test-reverse");
+        pose = Affine3d::Identity();
+        world.Set("a").Wrt("world").Ei("world").As(pose.matrix());
+        pose.translation() << 1, 2, 3;
+        world.Set("a").Wrt("b").Ei("a").As(pose.matrix());
+        assert((world.Get("b").Wrt("a").Ei("a").block<3,1>(0,3).isApprox(Vector3d(-1, -2, -3))));
+        WorldStats stats = world.Stats();
+        assert(stats.commits == 2 && stats.set_latency.count == 2 && stats.errors == 0);
+    }
+
+    //Once made, a Get whose frames did not change does not allocate memory, whatever the length of the names.
+    {
+        auto world = wrt.In("test");
+        pose = Affine3d::Identity();
+        world.Set("a-frame-with-a-long-name").Wrt("a").Ei("a").As(pose.matrix());
+        Eigen::Matrix4d expected = world.Get("a-frame-with-a-long-name").Wrt("world").Ei("b");
+        size_t before = allocations;
+        Eigen::Matrix4d cached = world.Get("a-frame-with-a-long-name").Wrt("world").Ei("b");
+        assert(allocations == before && cached == expected);
+    }
+
+    //The names of the frames are only kept while queries use them, such that timestamped names do not accumulate.
+    {
+        size_t names = NameTable::Frames().Size();
+        for(int i = 0; i < 100; i++){
+            string name = "stamped-"+to_string(i);
+            wrt.In("test").Set(name).Wrt("a").Ei("a").As(Eigen::Matrix4d::Identity());
+            assert(wrt.In("test").Get(name).Wrt("a").Ei("a").isApprox(Eigen::Matrix4d::Identity()));
+        }
+        assert(NameTable::Frames().Size() == names);
+        auto world = wrt.In("test");
+        world.Get("stamped-0").Wrt("a").Ei("a");
+        assert(NameTable::Frames().Size() > names);
+    }
+
+    //Frame name literals are validated at compile time and give the same results as the strings.
+    {
+        static_assert(VerifyInput("a-frame-2") && !VerifyInput("Gripper") && !VerifyInput("a_b") && !VerifyInput(""));
+        static_assert("a-frame-2"_frame.Hash() == HashName("a-frame-2") && "a"_frame.Name() == "a");
+        auto world = wrt.In("test");
+        assert(world.Get("c"_frame).Wrt("world"_frame).Ei("b"_frame) == world.Get("c").Wrt("world").Ei("b"));
+        world.Set("f"_frame).Wrt("a"_frame).Ei("world"_frame).As(Eigen::Matrix4d::Identity());
+        assert(world.Get("f").Wrt("a").Ei("a").isApprox(Eigen::Matrix4d::Identity()));
+        bool failed = false;
+        try{ world.Set("world"_frame); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+    }
+
+    //Poses are also given and returned as isometries, quaternions and arrays, in double or single precision.
+    {
+        auto world = wrt.In("test");
+        pose.linear() = AngleAxisd(deg_to_rad(30), Vector3d::UnitX()).toRotationMatrix();
+        pose.translation() << 1,2,3;
+        Quaterniond q(pose.linear());
+        world.Set("g").Wrt("a").Ei("a").As(Isometry3d(pose.matrix()));
+        assert(world.Get("g").Wrt("a").Ei("a").isApprox(pose.matrix()));
+        world.Set("g").Wrt("a").Ei("a").As(Quaterniond(2 * q.coeffs()), Vector3d(1,2,3));
+        assert(world.Get("g").Wrt("a").Ei("a").isApprox(pose.matrix()));
+        world.Set("g").Wrt("a").Ei("a").As(PoseArray{1, 2, 3, q.x(), q.y(), q.z(), q.w()});
+        assert(world.Get("g").Wrt("a").Ei<Isometry3d>("a").isApprox(Isometry3d(pose.matrix())));
+        world.Set("g").Wrt("a").Ei("a").Compile().As(Isometry3f(pose.matrix().cast<float>()));
+        assert(world.Get("g").Wrt("a").Ei("a").isApprox(pose.matrix(), 1e-6));
+        auto [rotation, translation] = world.Get("g"_frame).Wrt("a"_frame).Ei<PoseQuaternion>("a"_frame);
+        assert(abs(rotation.dot(q)) > 1 - 1e-6 && translation.isApprox(Vector3d(1,2,3)));
+        PoseArray array = world.Get("g").Wrt("a").Ei<PoseArray>("a");
+        assert(abs(array[3] * q.x() + array[4] * q.y() + array[5] * q.z() + array[6] * q.w()) > 1 - 1e-6);
+        assert(world.Get("g").Wrt("a").Compile("a").Evaluate<Matrix4f>().isApprox(pose.matrix().cast<float>()));
+        bool failed = false;
+        try{ world.Set("g").Wrt("a").Ei("a").As(Quaterniond(0,0,0,0), Vector3d(1,2,3)); }catch(const runtime_error& err){ failed = true; }
+        assert(failed);
+        failed = false;
+        try{ world.Set("g").Wrt("a").Ei("a").As(PoseArray{NAN, 2, 3, q.x(), q.y(), q.z(), q.w()}); }catch(const runtime_error& err){ failed = true; }
+        assert(failed && world.Get("g").Wrt("a").Ei("a").allFinite());
+    }
+
+    //A write lock held by another connection makes the Sets fail with a TimeoutError once their deadline passes, not the Gets.
+    {
+        SQLite::Database other("/tmp/test.db", SQLite::OPEN_READWRITE);
+        other.exec("BEGIN IMMEDIATE");
+        auto start = chrono::steady_clock::now();
+        bool timed_out = false;
+        try{ wrt.In("test").Set("a").Wrt("world").Ei("world").Within(50).As(Eigen::Matrix4d::Identity()); }catch(const TimeoutError& err){ timed_out = true; }
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        assert(timed_out && elapsed >= 50 && elapsed < 1000);
+        ConnectionOptions options;
+        options.busy_timeout = 20;
+        timed_out = false;
+        try{ DbConnector("/tmp", 0, options).In("test").Set("a").Wrt("world").Ei("world").As(Eigen::Matrix4d::Identity()); }catch(const TimeoutError& err){ timed_out = true; }
+        assert(timed_out);
+        wrt.In("test").Get("a").Wrt("world").Within(1).Ei("world");
+        other.exec("ROLLBACK");
+        wrt.In("test").Set("a").Wrt("world").Ei("world").Within(50).As(Eigen::Matrix4d::Identity());
+        //Writing from a transaction that read an outdated state fails right away, which is not a timeout.
+        auto db = DbConnector::Connect("/tmp/test", options);
+        db->exec("BEGIN");
+        db->exec("SELECT count(*) FROM frames");
+        wrt.In("test").Set("a").Wrt("world").Ei("world").As(Eigen::Matrix4d::Identity());
+        bool failed = false;
+        timed_out = false;
+        try{ CompiledSet(db, "/tmp/test", "a", "world", "world").As(Eigen::Matrix4d::Identity()); }
+        catch(const TimeoutError& err){ timed_out = true; }
+        catch(const runtime_error& err){ failed = true; }
+        assert(failed && !timed_out);
+        db->exec("ROLLBACK");
+    }
+
+    //The queries run in a transaction are committed together or not at all, and a read-only transaction reads a snapshot.
+    {
+        auto world = wrt.In("test");
+        auto other = wrt.In("test");
+        Eigen::Matrix4d moved = Eigen::Matrix4d::Identity();
+        moved(0,3) = 5;
+        {
+            auto transaction = world.Transaction();
+            world.Set("a").Wrt("world").Ei("world").As(moved);
+            assert(world.Get("a").Wrt("world").Ei("world")(0,3) == 5);
+            assert(other.Get("a").Wrt("world").Ei("world")(0,3) == 0);
+        }
+        assert(world.Get("a").Wrt("world").Ei("world")(0,3) == 0);
+        {
+            auto transaction = world.Transaction(true);
+            assert(world.Get("a").Wrt("world").Ei("world")(0,3) == 0);
+            other.Set("a").Wrt("world").Ei("world").As(moved);
+            assert(world.Get("a").Wrt("world").Ei("world")(0,3) == 0);
+            bool failed = false;
+            try{ world.Set("a").Wrt("world").Ei("world").As(moved); }catch(const runtime_error& err){ failed = true; }
+            assert(failed);
+            failed = false;
+            try{ world.Transaction(); }catch(const runtime_error& err){ failed = true; }
+            assert(failed);
+            transaction.Commit();
+        }
+        assert(world.Get("a").Wrt("world").Ei("world")(0,3) == 5);
+        auto transaction = world.Transaction();
+        world.Set("a").Wrt("world").Ei("world").As(Eigen::Matrix4d::Identity());
+        transaction.Commit();
+        assert(!transaction.Active() && other.Get("a").Wrt("world").Ei("world")(0,3) == 0);
+    }
+
+    //Copies of a world can be used from different threads, as each opens its own connection.
+    {
+        auto world = wrt.In("test");
+        auto expected = world.Get("c").Wrt("world").Ei("a");
+        atomic<int> mismatches(0);
+        vector<thread> threads;
+        for(int t = 0; t < 2; t++)
+            threads.emplace_back([world, &expected, &mismatches]() mutable {
+                for(int i = 0; i < 500; i++){
+                    if(!world.Get("c").Wrt("world").Ei("a").isApprox(expected))
+                        mismatches++;
+                    world.Get("b").Wrt("a").Ei(i % 2 ? "world" : "a");
+                }
+            });
+        for(auto& thread : threads)
+            thread.join();
+        assert(mismatches == 0);
+        //A copy does not share the connection, hence neither the transaction, of the original.
+        auto transaction = world.Transaction();
+        Eigen::Matrix4d moved = Eigen::Matrix4d::Identity();
+        moved(0,3) = 5;
+        world.Set("a").Wrt("world").Ei("world").As(moved);
+        auto copy = world;
+        assert(copy.Get("a").Wrt("world").Ei("world")(0,3) != 5);
+    }
+
+    //Trace events surround each operation, failures included, and stop once the callback is removed.
+    {
+        static vector<TraceEvent> events;
+        SetTraceCallback([](const TraceEvent& event){ events.push_back(event); });
+        auto world = wrt.In("test");
+        world.Set("a").Wrt("world").Ei("world").As(Eigen::Matrix4d::Identity());
+        bool failed = false;
+        try{ world.Get("undefined").Wrt("world").Ei("world"); }catch(const runtime_error& err){ failed = true; }
+        SetTraceCallback(nullptr);
+        world.Get("a").Wrt("world").Ei("world");
+        assert(failed);
+        auto count = [](TracePoint point){ return count_if(events.begin(), events.end(), [point](const TraceEvent& event){ return event.point == point; }); };
+        assert(count(TracePoint::set_enter) == 1 && count(TracePoint::set_exit) == 1);
+        assert(count(TracePoint::get_enter) == 1 && count(TracePoint::get_exit) == 1);
+        assert(count(TracePoint::begin) == 1 && count(TracePoint::commit) == 1);
+        assert(count(TracePoint::db_open) == 1 && count(TracePoint::prepare) > 0 && count(TracePoint::step) > 0);
+        assert(events.front().point == TracePoint::db_open && events.back().point == TracePoint::get_exit && events.back().value == 1);
+    }
+
     cout << "Congratulations! All tests passed." << endl;
 }
\ No newline at end of file